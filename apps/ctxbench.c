@@ -0,0 +1,112 @@
+/**************************************************************************
+ * Filename: ctxbench.c                                                   *
+ * Purpose: Measures context switch latency as a function of the number   *
+ *          of runnable processes sharing one priority                    *
+ **************************************************************************/
+#include <xinu.h>
+#include <stdlib.h>
+#include <run.h>
+
+#define CTXBENCH_SWITCHES 200000   // Yields performed by each run
+#define CTXBENCH_PRIO     30       // Priority of the worker processes
+#define CTXBENCH_STK      1024     // Stack size of a worker process
+
+void ctxbench_worker(int32 iters, sid32 start, sid32 done);
+int32 ctxbench_run(int32 nprocs);
+
+int ctxbench(int nargs, char *args[]) {
+  // Default comparison is a short ready list against a long one
+  int32 counts[] = { 8, 200 };
+  int32 i;
+
+  if (nargs > 3) {
+    printf("Usage: run ctxbench [<nprocs_a> [<nprocs_b>]]\n");
+    signal(run_command_done);
+    return SYSERR;
+  }
+  for (i = 1; i < nargs; i++) {
+    counts[i - 1] = atoi(args[i]);
+  }
+
+  printf("%8s %10s %10s %12s\n", "procs", "switches", "us", "ns/switch");
+  for (i = 0; i < 2; i++) {
+    if (ctxbench_run(counts[i]) == SYSERR) {
+      printf("ctxbench: could not run %d processes\n", counts[i]);
+    }
+  }
+
+  signal(run_command_done);
+  return OK;
+}
+
+/*
+ * Worker: wait for the start signal, then yield to the other workers
+ * of the same priority until its share of the switches is done.
+ */
+void ctxbench_worker(int32 iters, sid32 start, sid32 done) {
+  int32 i;
+
+  wait(start);
+  for (i = 0; i < iters; i++) {
+    yield();
+  }
+  signal(done);
+}
+
+/*
+ * Run one measurement with nprocs workers on the ready list.  The
+ * caller holds a higher priority while the workers are created so that
+ * none of them starts before the clock is read.
+ */
+int32 ctxbench_run(int32 nprocs) {
+  pid32 pids[nprocs];
+  sid32 start, done;
+  pri16 oldprio;
+  int32 iters, i;
+  uint64 t0, elapsed;
+  uint32 switches;
+
+  if (nprocs <= 0) {
+    return SYSERR;
+  }
+  iters = CTXBENCH_SWITCHES / nprocs;
+  switches = iters * nprocs;
+
+  start = semcreate(0);
+  done = semcreate(0);
+  oldprio = chprio(getpid(), CTXBENCH_PRIO + 1);
+
+  for (i = 0; i < nprocs; i++) {
+    pids[i] = create((void *) ctxbench_worker, CTXBENCH_STK, CTXBENCH_PRIO,
+                     "ctxbench", 3, iters, start, done);
+    if (pids[i] == SYSERR) {
+      // Not enough process table entries: clean up and report
+      while (--i >= 0) {
+        kill(pids[i]);
+      }
+      chprio(getpid(), oldprio);
+      semdelete(start);
+      semdelete(done);
+      return SYSERR;
+    }
+    resume(pids[i]);
+  }
+
+  // All workers are waiting on start; release them onto the ready list
+  signaln(start, nprocs);
+
+  t0 = getcycles();
+  for (i = 0; i < nprocs; i++) {
+    wait(done);
+  }
+  elapsed = cycles2ns(getcycles() - t0);
+
+  chprio(getpid(), oldprio);
+  semdelete(start);
+  semdelete(done);
+
+  printf("%8d %10d %10d %12d\n", nprocs, switches,
+         (uint32) udiv64(elapsed, 1000, NULL),
+         (uint32) udiv64(elapsed, switches, NULL));
+  return OK;
+}
@@ -243,6 +243,311 @@ int fstest_overwrite() {
 	ASSERT_PASS(bs_freedev(0))
 	return OK;
 }
+
+/**
+ * Write a file that runs through the direct, indirect and
+ * double-indirect blocks, then read it back in pieces that straddle
+ * block boundaries.
+ */
+int fstest_indirect() {
+	int i, fd;
+	int buf_size = (INODEDIRECTBLOCKS + (MDEV_BLOCK_SIZE / sizeof(int)) + 12) * MDEV_BLOCK_SIZE + 77;
+	int chunk = 333;
+	char *buf1, *buf2;
+
+	buf1 = getmem(buf_size);
+	buf2 = getmem(buf_size);
+	for (i = 0; i < buf_size; i++) {
+		buf1[i] = (char) (i + i / MDEV_BLOCK_SIZE);
+		buf2[i] = (char) 0;
+	}
+
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+	ASSERT_PASS(fd = fs_create("big", O_CREAT))
+
+	for (i = 0; i < buf_size; i += chunk) {
+		ASSERT_TRUE(fs_write(fd, &buf1[i], (buf_size - i < chunk) ? buf_size - i : chunk) > 0)
+	}
+	ASSERT_PASS(fs_seek(fd, 0))
+	ASSERT_TRUE(fs_read(fd, buf2, buf_size) == buf_size)
+	for (i = 0; i < buf_size; i++) {
+		ASSERT_TRUE(buf1[i] == buf2[i])
+	}
+
+	// Random access into the double-indirect range
+	i = buf_size - 3 * MDEV_BLOCK_SIZE - 5;
+	ASSERT_PASS(fs_seek(fd, i))
+	ASSERT_TRUE(fs_read(fd, buf2, 600) == 600)
+	ASSERT_TRUE(memcmp(&buf1[i], buf2, 600) == 0)
+	ASSERT_TRUE(fs_read(fd, buf2, buf_size) == buf_size - i - 600)
+
+	ASSERT_PASS(fs_close(fd))
+	ASSERT_PASS(freemem(buf1, buf_size))
+	ASSERT_PASS(freemem(buf2, buf_size))
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
+
+/**
+ * Preallocate a file in one run, check it didn't grow and that its
+ * blocks are contiguous, then fill it and read it back.
+ */
+int fstest_fallocate() {
+	int i, fd, blk;
+	int nblocks = 40;
+	int buf_size = nblocks * MDEV_BLOCK_SIZE;
+	char *buf1, *buf2;
+
+	buf1 = getmem(buf_size);
+	buf2 = getmem(buf_size);
+	for (i = 0; i < buf_size; i++) {
+		buf1[i] = (char) (i * 3);
+	}
+
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+
+	// Leave a few holes in the mask so the file has to skip them
+	ASSERT_PASS(fd = fs_create("small", O_CREAT))
+	ASSERT_TRUE(fs_write(fd, buf1, 3 * MDEV_BLOCK_SIZE) == 3 * MDEV_BLOCK_SIZE)
+	ASSERT_PASS(fs_close(fd))
+
+	ASSERT_PASS(fd = fs_create("big", O_CREAT))
+	ASSERT_FAIL(fs_fallocate(fd, -1))
+	ASSERT_PASS(fs_fallocate(fd, buf_size))
+	ASSERT_FAIL(fs_seek(fd, 1))  // Size is still 0
+	blk = _fs_fileblock_to_diskblock(0, fd, 0);
+	ASSERT_TRUE(blk > 0)
+	for (i = 1; i < INODEDIRECTBLOCKS; i++) {
+		ASSERT_TRUE(_fs_fileblock_to_diskblock(0, fd, i) == blk + i)
+	}
+
+	ASSERT_TRUE(fs_write(fd, buf1, buf_size) == buf_size)
+	ASSERT_PASS(fs_seek(fd, 0))
+	ASSERT_TRUE(fs_read(fd, buf2, buf_size) == buf_size)
+	ASSERT_TRUE(memcmp(buf1, buf2, buf_size) == 0)
+
+	ASSERT_PASS(fs_close(fd))
+	ASSERT_PASS(freemem(buf1, buf_size))
+	ASSERT_PASS(freemem(buf2, buf_size))
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
+
+/**
+ * Inodes live in memory: check that closing a file writes its inode
+ * back to the device and that an unlinked file's inode is reused.
+ */
+int fstest_inodecache() {
+	int fd, fd2;
+	char buf[100];
+	inode_t in;
+
+	memset(buf, 'x', sizeof(buf));
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+
+	ASSERT_PASS(fd = fs_create("a", O_CREAT))
+	ASSERT_PASS(fd2 = fs_create("b", O_CREAT))
+	ASSERT_TRUE(fs_write(fd, buf, sizeof(buf)) == sizeof(buf))
+	ASSERT_PASS(_fs_get_inode_by_num(0, 1, &in))
+	ASSERT_TRUE(in.size == sizeof(buf))
+	ASSERT_PASS(fs_close(fd))
+
+	// Inode 1 ("a", after the root directory) is second in the first
+	// inode block, right after the bitmap block
+	ASSERT_PASS(bs_bread(0, 2, sizeof(inode_t), &in, sizeof(inode_t)))
+	ASSERT_TRUE(in.id == 1 && in.nlink == 1 && in.size == sizeof(buf))
+
+	ASSERT_PASS(fs_link("b", "c"))
+	ASSERT_PASS(fs_unlink("a"))
+	ASSERT_PASS(_fs_get_inode_by_num(0, 1, &in))
+	ASSERT_TRUE(in.id == EMPTY)
+	ASSERT_PASS(fd = fs_create("d", O_CREAT))
+	ASSERT_PASS(_fs_get_inode_by_num(0, 1, &in))
+	ASSERT_TRUE(in.id == 1 && in.size == 0)
+	ASSERT_PASS(_fs_get_inode_by_num(0, 2, &in))
+	ASSERT_TRUE(in.id == 2 && in.nlink == 2)
+
+	ASSERT_PASS(fs_close(fd))
+	ASSERT_PASS(fs_close(fd2))
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
+
+/**
+ * Nested directories, and a directory with more names than fit in the
+ * inode table (as hard links), checked through fs_readdir.
+ */
+int fstest_dirs() {
+	int fd, i, n, pos;
+	char name[FILENAMELEN + 8];
+	char buf[8] = "1234567";
+	char buf2[8];
+	dirent_t de;
+	int nlinks = 1000;
+
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+
+	ASSERT_PASS(fs_mkdir("d1"))
+	ASSERT_PASS(fs_mkdir("/d1/d2"))
+	ASSERT_FAIL(fs_mkdir("d1"))
+	ASSERT_FAIL(fs_mkdir("nodir/d3"))
+	ASSERT_FAIL(fs_create("nodir/f", O_CREAT))
+
+	ASSERT_PASS(fd = fs_create("d1/d2/f", O_CREAT))
+	ASSERT_TRUE(fs_write(fd, buf, 8) == 8)
+	ASSERT_PASS(fs_close(fd))
+	ASSERT_FAIL(fs_open("d1/d2", O_RDONLY))
+	ASSERT_FAIL(fs_open("d1/f", O_RDONLY))
+	ASSERT_PASS(fd = fs_open("/d1//d2/f", O_RDONLY))
+	ASSERT_TRUE(fs_read(fd, buf2, 8) == 8)
+	ASSERT_TRUE(memcmp(buf, buf2, 8) == 0)
+	ASSERT_PASS(fs_close(fd))
+
+	// Many names for one file in d1
+	for (i = 0; i < nlinks; i++) {
+		sprintf(name, "d1/l%d", i);
+		ASSERT_PASS(fs_link("d1/d2/f", name))
+	}
+	ASSERT_FAIL(fs_link("d1/d2/f", "d1/l7"))
+	for (i = 0; i < nlinks; i += 2) {
+		sprintf(name, "d1/l%d", i);
+		ASSERT_PASS(fs_unlink(name))
+		ASSERT_FAIL(fs_unlink(name))
+	}
+	ASSERT_FAIL(fs_unlink("d1/d2"))
+
+	// d2 and every odd link are left
+	n = 0;
+	pos = 0;
+	while (fs_readdir("d1", &pos, &de) == OK) {
+		n++;
+	}
+	ASSERT_TRUE(n == 1 + nlinks / 2)
+	ASSERT_TRUE(fs_readdir("d1", &pos, &de) == EOF)
+	ASSERT_FAIL(fs_readdir("d1/d2/f", &pos, &de))
+
+	// Freed slots are reused, so the directory doesn't grow
+	n = pos;
+	ASSERT_PASS(fs_link("d1/d2/f", "d1/again"))
+	for (i = 2; i < nlinks; i += 2) {
+		sprintf(name, "d1/r%d", i);
+		ASSERT_PASS(fs_link("d1/d2/f", name))
+	}
+	pos = 0;
+	while (fs_readdir("d1", &pos, &de) == OK);
+	ASSERT_TRUE(pos == n)
+	ASSERT_PASS(fd = fs_open("d1/l999", O_RDONLY))
+	ASSERT_TRUE(fs_read(fd, buf2, 8) == 8)
+	ASSERT_TRUE(memcmp(buf, buf2, 8) == 0)
+	ASSERT_PASS(fs_close(fd))
+
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
+
+/**
+ * Unlinking the last name of a file gives back its data and indirect
+ * blocks, so writing and removing a big file can go on forever.
+ */
+int fstest_reclaim() {
+	int i, fd;
+	int nblocks = 100;
+	int buf_size = nblocks * MDEV_BLOCK_SIZE;
+	char *buf;
+
+	buf = getmem(buf_size);
+	memset(buf, 'r', buf_size);
+
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+
+	// Far more than the device holds at once
+	for (i = 0; i < 4 * MDEV_NUM_BLOCKS / nblocks; i++) {
+		ASSERT_PASS(fd = fs_create("big", O_CREAT))
+		ASSERT_TRUE(fs_write(fd, buf, buf_size) == buf_size)
+		ASSERT_PASS(fs_close(fd))
+		ASSERT_PASS(fs_link("big", "big2"))
+		ASSERT_PASS(fs_unlink("big"))
+		ASSERT_PASS(fs_unlink("big2"))
+	}
+
+	ASSERT_PASS(freemem(buf, buf_size))
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
+
+/**
+ * A preallocated file maps in one piece.  Files written a block at a
+ * time in turn are split up, so fs_map gives them a run at a time, and
+ * fs_read still copies them across the gaps.
+ */
+int fstest_map() {
+	int i, n, fd, fd2;
+	int nblocks = 20;
+	int buf_size = nblocks * MDEV_BLOCK_SIZE;
+	char *buf1, *buf2;
+	void *p;
+
+	buf1 = getmem(buf_size);
+	buf2 = getmem(buf_size);
+	for (i = 0; i < buf_size; i++) {
+		buf1[i] = (char) (i * 7);
+	}
+
+	ASSERT_PASS(bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS))
+	ASSERT_PASS(fs_mkfs(0, DEFAULT_NUM_INODES))
+
+	ASSERT_PASS(fd = fs_create("whole", O_CREAT))
+	ASSERT_PASS(fs_fallocate(fd, buf_size))
+	ASSERT_TRUE(fs_write(fd, buf1, buf_size) == buf_size)
+	ASSERT_TRUE(fs_map(fd, 0, buf_size, &p) == buf_size)
+	ASSERT_TRUE(memcmp(buf1, p, buf_size) == 0)
+	ASSERT_TRUE(fs_map(fd, 1000, 100, &p) == 100)
+	ASSERT_TRUE(memcmp(&buf1[1000], p, 100) == 0)
+	ASSERT_TRUE(fs_map(fd, buf_size - 10, 100, &p) == 10)
+	ASSERT_TRUE(fs_map(fd, buf_size, 100, &p) == 0)
+	ASSERT_FAIL(fs_map(fd, buf_size + 1, 100, &p))
+	ASSERT_FAIL(fs_map(fd, -1, 100, &p))
+	ASSERT_PASS(fs_close(fd))
+
+	ASSERT_PASS(fd = fs_create("odd", O_CREAT))
+	ASSERT_PASS(fd2 = fs_create("even", O_CREAT))
+	for (i = 0; i < nblocks; i++) {
+		ASSERT_TRUE(fs_write(fd, &buf1[i * MDEV_BLOCK_SIZE], MDEV_BLOCK_SIZE) == MDEV_BLOCK_SIZE)
+		ASSERT_TRUE(fs_write(fd2, buf2, MDEV_BLOCK_SIZE) == MDEV_BLOCK_SIZE)
+	}
+	n = fs_map(fd, 0, buf_size, &p);
+	ASSERT_TRUE(n > 0 && n < buf_size)
+
+	// Put it back together a run at a time
+	for (i = 0; i < buf_size; i += n) {
+		ASSERT_TRUE((n = fs_map(fd, i, buf_size - i, &p)) > 0)
+		memcpy(&buf2[i], p, n);
+	}
+	ASSERT_TRUE(memcmp(buf1, buf2, buf_size) == 0)
+
+	memset(buf2, 0, buf_size);
+	ASSERT_PASS(fs_seek(fd, 100))
+	ASSERT_TRUE(fs_read(fd, buf2, buf_size) == buf_size - 100)
+	ASSERT_TRUE(memcmp(&buf1[100], buf2, buf_size - 100) == 0)
+
+	ASSERT_PASS(fs_close(fd))
+	ASSERT_PASS(fs_close(fd2))
+	ASSERT_PASS(freemem(buf1, buf_size))
+	ASSERT_PASS(freemem(buf2, buf_size))
+	ASSERT_PASS(fs_freefs(0));
+	ASSERT_PASS(bs_freedev(0))
+	return OK;
+}
 #endif
 
 
@@ -268,12 +573,26 @@ int fstest(int nargs, char *args[]) {
 
 #ifdef FS
 
+  // Every test makes and frees its own device, so drop the one that is
+  // up (e.g. tscdf_conv's) rather than leak it; it is made again on use
+  if (fs_mounted(0)) {
+    printf("fstest: removing the existing filesystem\n");
+    fs_freefs(0);
+    bs_freedev(0);
+  }
+
   printf("\n\n\n");
   TEST(fstest_testbitmask)
   TEST(fstest_mkdev)
 	TEST(fstest_rdwr)
 	TEST(fstest_unlink)
 	TEST(fstest_overwrite)
+	TEST(fstest_indirect)
+	TEST(fstest_fallocate)
+	TEST(fstest_inodecache)
+	TEST(fstest_dirs)
+	TEST(fstest_reclaim)
+	TEST(fstest_map)
 
 #else
   printf("No filesystem support\n");
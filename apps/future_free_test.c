@@ -7,6 +7,7 @@ uint32 get_heap_size(void) {
   uint32 stack = 0;      /* Total used stack memory  */
   uint32 kfree = 0;      /* Total free memory    */
   struct memblk *block;  /* Ptr to memory block    */
+  uint32 slab = 0;       /* Free space in slab pages */
 
   /* Calculate amount of allocated stack memory */
   /*  Skip the NULL process since it has a private stack */
@@ -21,7 +22,13 @@ uint32 get_heap_size(void) {
     kfree += block->mlength;
   }
 
-  return kfree - stack;
+  /* Futures come from the slab allocator, so space held by slab pages */
+  /*  but not used by live objects still counts as available heap */
+  for (i = 0; i < NSLABCLS; i++) {
+    slab += slabavail(&slabtab[i]);
+  }
+
+  return kfree + slab - stack;
 }
 
 int future_free_test(int nargs, char *args[]) {
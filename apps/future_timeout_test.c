@@ -0,0 +1,126 @@
+#include <xinu.h>
+#include <future.h>
+
+void timeout_getter(future_t *f, sid32 done);
+void timeout_signaler(sid32 sem);
+void timeout_setter(future_t *f, pid32 getter, int value, sid32 done);
+
+int future_timeout_test(int nargs, char *args[]) {
+
+  future_t *f;
+  sid32 sem, done;
+  int value = 7, out = 0;
+  uint32 start, elapsed;
+  pid32 getter;
+
+  // An empty exclusive future times out and is usable again afterwards
+  f = future_alloc(FUTURE_EXCLUSIVE, sizeof(int), 1);
+  start = clktime * 1000 + clkticks;
+  if (future_get_timeout(f, (char *)&out, 50) != TIMEOUT) {
+    printf("future exclusive get did not time out\n");
+    return OK;
+  }
+  elapsed = clktime * 1000 + clkticks - start;
+  if (elapsed < 50) {
+    printf("future exclusive get timed out after %d ms\n", elapsed);
+    return OK;
+  }
+  if (future_set(f, (char *)&value) != OK
+      || future_get_timeout(f, (char *)&out, 50) != OK || out != value) {
+    printf("future exclusive did not recover after a timeout\n");
+    return OK;
+  }
+  future_free(f);
+  printf("future exclusive timed out after %d ms\n", elapsed);
+
+  // A set that lands after the getter's timeout fired, but before the
+  // getter runs again, must not ready it twice or lose the value
+  f = future_alloc(FUTURE_EXCLUSIVE, sizeof(int), 1);
+  done = semcreate(0);
+  resume(create(timeout_setter, 2048, getprio(getpid()) + 10, "fsetter", 4,
+                f, getpid(), value, done));
+  if (future_get_timeout(f, (char *)&out, 30) != TIMEOUT) {
+    printf("future exclusive get beat the late set\n");
+    return OK;
+  }
+  wait(done);
+  if (future_get_timeout(f, (char *)&out, 0) != OK || out != value) {
+    printf("future exclusive lost a set made as it timed out\n");
+    return OK;
+  }
+  semdelete(done);
+  future_free(f);
+  printf("future exclusive kept a set made as it timed out\n");
+
+  // An empty queue future times out without losing its place in line
+  f = future_alloc(FUTURE_QUEUE, sizeof(int), 2);
+  if (future_get_timeout(f, (char *)&out, 0) != TIMEOUT
+      || future_get_timeout(f, (char *)&out, 20) != TIMEOUT) {
+    printf("future queue get did not time out\n");
+    return OK;
+  }
+  future_set(f, (char *)&value);
+  if (future_get_timeout(f, (char *)&out, 20) != OK || out != value) {
+    printf("future queue did not recover after a timeout\n");
+    return OK;
+  }
+  printf("future queue timed out\n");
+
+  // Freeing a future with a timed waiter cancels the waiter's timer
+  done = semcreate(0);
+  getter = create(timeout_getter, 2048, 30, "ftimeout", 2, f, done);
+  resume(getter);
+  if (future_free(f) != OK) {
+    printf("future queue free with a timed waiter failed\n");
+    return OK;
+  }
+  sleepms(200);
+  if (semcount(done) != 0 || tmtab[getter].tmnext != EMPTY) {
+    printf("future queue free left a timed waiter behind\n");
+    return OK;
+  }
+  semdelete(done);
+  printf("future queue freed with a timed waiter\n");
+
+  // waittime times out, restores the count, and succeeds when signaled
+  sem = semcreate(0);
+  if (waittime(sem, 30) != TIMEOUT || semcount(sem) != 0) {
+    printf("waittime did not time out cleanly\n");
+    return OK;
+  }
+  resume(create(timeout_signaler, 2048, 20, "wsignal", 1, sem));
+  if (waittime(sem, 1000) != OK || semcount(sem) != 0) {
+    printf("waittime missed a signal\n");
+    return OK;
+  }
+  semdelete(sem);
+  printf("waittime timed out and was signaled\n");
+
+  return OK;
+}
+
+// Wait on a future long enough for it to be freed first
+void timeout_getter(future_t *f, sid32 done) {
+  int out;
+  future_get_timeout(f, (char *)&out, 100);
+  signal(done);
+}
+
+// Once the getter's timer has made it ready, set the future before the
+// (lower priority) getter gets to run
+void timeout_setter(future_t *f, pid32 getter, int value, sid32 done) {
+  sleepms(10);
+  while (proctab[getter].prstate == PR_FWAIT) {
+    yield();  // The getter has lower priority, so this doesn't let it run
+  }
+  if (future_set(f, (char *)&value) != OK) {
+    printf("future exclusive late set failed\n");
+  }
+  signal(done);
+}
+
+// Signal a semaphore after a short delay
+void timeout_signaler(sid32 sem) {
+  sleepms(10);
+  signal(sem);
+}
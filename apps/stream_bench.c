@@ -0,0 +1,177 @@
+/**************************************************************************
+ * Filename: stream_bench.c                                               *
+ * Purpose: Sweeps tscdf and tscdf_fq over streams, queue depth, window   *
+ *          and output interval, printing one table row per run           *
+ **************************************************************************/
+#include <xinu.h>
+#include <stdlib.h>
+#include <run.h>
+#include <stream.h>
+#include "tsketch.h"
+
+#define BENCH_MAXVALS 8    // Most values in one -s/-w/-t/-o list
+#define BENCH_EPS     10000 // Latency percentiles to within 1%
+
+struct stream_stats *stream_bench = NULL;
+
+static int32 bench_list(char *s, int32 *vals);
+static int32 bench_run(int32 futures, int32 s, int32 w, int32 t, int32 o);
+
+static const int32 bench_ranks[4] = { 500, 900, 990, 1000 };
+
+// Called by the consumers for every record while a bench run is going
+void stream_bench_record(uint32 stamp) {
+	intmask mask;
+
+	mask = disable();
+	stream_bench->records++;
+	tsketch_add(stream_bench->latency, (int32) ((uint32) getcycles() - stamp));
+	restore(mask);
+}
+
+int bench(int nargs, char *args[]) {
+	char usage[] = "Usage: run bench stream [-s <list>] [-w <list>] [-t <list>] [-o <list>]\n";
+	// Each list is comma separated, e.g. -s 10,16,24
+	// The built-in input has 10 streams; more only adds idle consumers
+	int32 s[BENCH_MAXVALS] = { 10 };
+	int32 w[BENCH_MAXVALS] = { 8, 64 };
+	int32 t[BENCH_MAXVALS] = { 16, 128 };
+	int32 o[BENCH_MAXVALS] = { 64 };
+	int32 ns = 1, nw = 2, nt = 2, no = 1;
+	int32 *n;
+	int32 i, a, b, c, d, m;
+
+	if (nargs < 2 || strncmp(args[1], "stream", 7) != 0 || (nargs % 2) != 0) {
+		printf("%s", usage);
+		signal(run_command_done);
+		return SYSERR;
+	}
+	for (i = 2; i < nargs; i += 2) {
+		switch (args[i][1]) {
+			case 's': n = &ns; *n = bench_list(args[i + 1], s); break;
+			case 'w': n = &nw; *n = bench_list(args[i + 1], w); break;
+			case 't': n = &nt; *n = bench_list(args[i + 1], t); break;
+			case 'o': n = &no; *n = bench_list(args[i + 1], o); break;
+			default: n = NULL; break;
+		}
+		if (n == NULL || *n == SYSERR) {
+			printf("%s", usage);
+			signal(run_command_done);
+			return SYSERR;
+		}
+	}
+
+	// One header line, then whitespace separated columns with no units
+	printf("# mode streams depth window output records ms rec_per_s p50_ns p90_ns p99_ns max_ns ctxsw\n");
+	for (m = 0; m < 2; m++) {
+		for (a = 0; a < ns; a++) {
+			for (b = 0; b < nw; b++) {
+				for (c = 0; c < nt; c++) {
+					for (d = 0; d < no; d++) {
+						if (bench_run(m, s[a], w[b], t[c], o[d]) == SYSERR) {
+							printf("# %s -s %d -w %d -t %d -o %d failed\n",
+							       m ? "tscdf_fq" : "tscdf", s[a], w[b], t[c], o[d]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	signal(run_command_done);
+	return OK;
+}
+
+// Parse "1,10,32" into vals; returns how many there were
+static int32 bench_list(char *s, int32 *vals) {
+	int32 n = 0;
+
+	while (*s != '\0') {
+		if (n == BENCH_MAXVALS || *s < '0' || *s > '9') {
+			return SYSERR;
+		}
+		vals[n++] = atoi(s);
+		while (*s >= '0' && *s <= '9') {
+			s++;
+		}
+		if (*s == ',') {
+			s++;
+		}
+	}
+	return (n == 0) ? SYSERR : n;
+}
+
+/*
+ * Run one pipeline to completion with the console quiet.  The pipeline
+ * signals run_command_done when it is finished, so that is swapped for
+ * a semaphore of our own for the length of the run.
+ */
+static int32 bench_run(int32 futures, int32 s, int32 w, int32 t, int32 o) {
+	struct stream_stats stats;
+	char sv[12], wv[12], tv[12], ov[12];
+	char *argv[9];
+	int32 lat[4];
+	sid32 done, saved;
+	pid32 pid;
+	uint64 t0, elapsed_us;
+	uint32 sw0, rate;
+
+	sprintf(sv, "%d", s);
+	sprintf(wv, "%d", w);
+	sprintf(tv, "%d", t);
+	sprintf(ov, "%d", o);
+	argv[0] = futures ? "tscdf_fq" : "tscdf";
+	argv[1] = "-s"; argv[2] = sv;
+	argv[3] = "-w"; argv[4] = wv;
+	argv[5] = "-t"; argv[6] = tv;
+	argv[7] = "-o"; argv[8] = ov;
+
+	stats.records = 0;
+	stats.latency = tsketch_init(1 << 30, BENCH_EPS);
+	if (stats.latency == NULL) {
+		return SYSERR;
+	}
+	done = semcreate(0);
+	if (done == SYSERR) {
+		tsketch_free(stats.latency);
+		return SYSERR;
+	}
+	saved = run_command_done;
+	run_command_done = done;
+	stream_bench = &stats;
+
+	sw0 = nctxsw;
+	t0 = gettime_ns();
+	if (futures) {
+		pid = create((void *) stream_proc_futures, 4096, 20, "stream_proc_futures", 2, 9, argv);
+	} else {
+		pid = create((void *) stream_proc, 4096, 20, "stream_proc", 2, 9, argv);
+	}
+	if (pid != SYSERR) {
+		resume(pid);
+		wait(done);
+	}
+	elapsed_us = udiv64(gettime_ns() - t0, 1000, NULL);
+	sw0 = nctxsw - sw0;
+
+	stream_bench = NULL;
+	run_command_done = saved;
+	semdelete(done);
+
+	if (pid == SYSERR || stats.records == 0
+	    || tsketch_quantiles(stats.latency, bench_ranks, lat, 4) == SYSERR) {
+		tsketch_free(stats.latency);
+		return SYSERR;
+	}
+	tsketch_free(stats.latency);
+	if (elapsed_us == 0) {
+		elapsed_us = 1;
+	}
+	rate = (uint32) udiv64((uint64) stats.records * 1000000, (uint32) elapsed_us, NULL);
+
+	printf("%s %d %d %d %d %u %u %u %u %u %u %u %u\n", argv[0], s, w, t, o,
+	       stats.records, (uint32) udiv64(elapsed_us, 1000, NULL), rate,
+	       (uint32) cycles2ns(lat[0]), (uint32) cycles2ns(lat[1]),
+	       (uint32) cycles2ns(lat[2]), (uint32) cycles2ns(lat[3]), sw0);
+	return OK;
+}
@@ -5,31 +5,103 @@
  * Date: 3/17/2022                                                        *
  **************************************************************************/
 #include "tscdf.h"
+#include "tscdf_cols.h"
 #include <stream.h>
 #include <string.h>
 #include <stdlib.h>
 #include <run.h>
 
+struct stream_shard;
 void stream_consumer(int32 id, struct stream *str);
+void stream_shard_consumer(int32 id, struct stream_shard *sh);
+void stream_aggregator(int32 num_streams);
+static bool8 stream_record(int32 id, de* elem, int *count, struct tsketch *pub);
+static struct tsketch* stream_pub_init(struct tscdf *tc);
+static void stream_pub_done(int32 id, struct tscdf *tc, struct tsketch *pub);
+static void stream_publish(int32 id, struct tsketch *sk);
+static void stream_flush(struct stream *str, de* buf, int n);
+static void stream_shard_put(int32 st, int ts, int v);
 struct stream* streams;
 struct tscdf** tscdf_arr; // An array of pointers to tscdf structs
 int work_queue_depth, output_time;
 int32 sync_port;
 
+// With -g every consumer sends a summary of its window to the aggregator
+// each output_time values, and the aggregator merges the latest summary
+// from every stream into global quantiles.  A NULL sketch means the
+// stream has finished.
+struct stream_summary {
+	int32 id;
+	struct tsketch *sk;
+};
+static int32 global_port = -1; // Aggregator's port, -1 without -g
+static int32 global_eps; // Summary accuracy in ppm
+static const int32 global_ranks[6] = { 0, 250, 500, 750, 990, 1000 };
+
+// With -c a fixed pool of consumers serves all the streams: consumer k
+// owns every stream s with s % num_consumers == k.  Its shard keeps the
+// ids of its streams that hold records in a FIFO, so the consumer goes
+// straight to a stream with work and drains it, and streams need no
+// semaphores or processes of their own.
+struct stream_shard {
+	sid32 ready; // Stream ids in the FIFO
+	sid32 mutex; // Guards the FIFO and the shard's stream queues
+	sid32 freed; // Signaled when space frees up for a waiting producer
+	bool8 pwaiting; // The producer is blocked on a full queue
+	int32 nstreams; // Streams owned by the shard
+	int32 *fifo; // Ids of streams with records, each at most once
+	int32 fhead, ftail;
+};
+struct stream_state {
+	int32 fill; // Records in the stream's queue
+	bool8 queued; // Stream is in its shard's FIFO
+	int32 count; // Records since the last report
+	struct tsketch *pub;
+};
+static int num_consumers; // 0 without -c: one process per stream
+static struct stream_shard *shards;
+static struct stream_state *stream_states;
+
 int stream_proc(int nargs, char* args[]) {
-	ulong secs, msecs, time;
-	secs = clktime;
-	msecs = clkticks;
+	uint64 start_ns;
+	ulong time;
+	start_ns = gettime_ns();
 
   // Parse input
 	int num_streams = 0;
 	int time_window = 0;
+	bool8 time_based = FALSE; // -t 500t: values from the last 500 timestamp units
+
+	char usage[] = "Usage: run tscdf -s <num_streams> -w <work_queue_depth> -t <time_window>[t] -o <output_time> [-a <epsilon>] [-g <epsilon>] [-i <file>] [-b <batch>] [-c <consumers>] [-l]\n";
 
-	char usage[] = "Usage: run tscdf -s <num_streams> -w <work_queue_depth> -t <time_window> -o <output_time>\n";
+	int32 epsilon = 0; // Approximate windows (-a) when nonzero, in ppm
+	int32 gepsilon = 0; // Global view (-g) when nonzero, in ppm
 
-	int i;
+	char* input_file = NULL; // Packed input on the fs (-i), else the built-in one
+	struct tscdf_cols cols;
+	char* blob = NULL;
+	int32 blob_len = 0;
+	bool8 blob_mapped = FALSE; // blob is the file itself, mapped from the fs
+	int batch_size = 0; // Records staged per stream before a flush (-b)
+	int nprocs; // Consumer processes to join
+	bool8 use_ring = FALSE; // Lock-free SPSC rings instead of semaphores (-l)
+
+	int i, j;
 	char *ch, c;
-	if (nargs != 9) {
+	num_consumers = 0;
+
+	// -l takes no value, so take it out before the pairs are parsed
+	for (i = 1; i < nargs; i++) {
+		if (strncmp(args[i], "-l", 3) == 0) {
+			use_ring = TRUE;
+			for (j = i; j < nargs - 1; j++) {
+				args[j] = args[j + 1];
+			}
+			nargs--;
+			break;
+		}
+	}
+	if (nargs < 9 || nargs > 19 || (nargs % 2) == 0) {
 		printf("%s", usage);
 		signal(run_command_done);
 		return SYSERR;
@@ -50,12 +122,43 @@ int stream_proc(int nargs, char* args[]) {
 
 				case 't':
 					time_window = atoi(args[i]);
+					time_based = (args[i][strlen(args[i]) - 1] == 't');
 					break;
 
 				case 'o':
 					output_time = atoi(args[i]);
 					break;
 
+				case 'a':
+					epsilon = tsketch_parse_epsilon(args[i]);
+					if (epsilon == SYSERR) {
+						printf("%s", usage);
+						signal(run_command_done);
+						return SYSERR;
+					}
+					break;
+
+				case 'g':
+					gepsilon = tsketch_parse_epsilon(args[i]);
+					if (gepsilon == SYSERR) {
+						printf("%s", usage);
+						signal(run_command_done);
+						return SYSERR;
+					}
+					break;
+
+				case 'i':
+					input_file = args[i];
+					break;
+
+				case 'b':
+					batch_size = atoi(args[i]);
+					break;
+
+				case 'c':
+					num_consumers = atoi(args[i]);
+					break;
+
 				default:
 					printf("%s", usage);
 					signal(run_command_done);
@@ -65,6 +168,43 @@ int stream_proc(int nargs, char* args[]) {
 			i -= 2;
 		}
 	}	
+	// A batch can never wait for more spaces than the queue holds
+	if (batch_size > work_queue_depth) {
+		batch_size = work_queue_depth;
+	}
+
+	if (num_consumers > num_streams) {
+		num_consumers = num_streams;
+	}
+
+	// Sketches expire values by count, so they cannot follow a time window,
+	// and an SPSC ring has exactly one consumer per stream
+	if ((time_based && (epsilon > 0 || gepsilon > 0)) || (use_ring && num_consumers > 0)) {
+		printf("%s", usage);
+		signal(run_command_done);
+		return SYSERR;
+	}
+
+  // Load the input columns: records are read in place, with no parsing
+	if (input_file != NULL) {
+		blob = tscdf_cols_load(input_file, &blob_len, &blob_mapped);
+		if (blob == NULL || tscdf_cols_view(blob, blob_len, &cols) == SYSERR) {
+			printf("cannot load input file %s\n", input_file);
+			tscdf_cols_release(blob, blob_len, blob_mapped);
+			signal(run_command_done);
+			return SYSERR;
+		}
+	} else if (tscdf_cols_builtin(&cols) == SYSERR) {
+		printf("cannot convert the built-in input\n");
+		signal(run_command_done);
+		return SYSERR;
+	}
+	if (cols.nstreams > num_streams) {
+		printf("input has %d streams, only %d requested\n", cols.nstreams, num_streams);
+		tscdf_cols_release(blob, blob_len, blob_mapped);
+		signal(run_command_done);
+		return SYSERR;
+	}
 
   // Create streams:
 	//
@@ -75,70 +215,193 @@ int stream_proc(int nargs, char* args[]) {
 	// Each stream needs a tscdf
 	tscdf_arr = (struct tscdf **) getmem(sizeof(struct tscdf *) * num_streams);
 	for (i = 0; i < num_streams; i++) {
-		tscdf_arr[i] = tscdf_init(time_window);
+		if (epsilon > 0) {
+			tscdf_arr[i] = tscdf_init_approx(time_window, epsilon);
+		} else if (time_based) {
+			tscdf_arr[i] = tscdf_init_time(time_window);
+		} else {
+			tscdf_arr[i] = tscdf_init(time_window);
+		}
+		// A shard consumer is the only process touching its windows, so
+		// they give up their mutexes rather than fill the semaphore table
+		if (num_consumers > 0) {
+			tscdf_private(tscdf_arr[i]);
+		}
 	}
 
-	sync_port = ptcreate(num_streams);
+	nprocs = (num_consumers > 0) ? num_consumers : num_streams;
+	sync_port = ptcreate(nprocs + 1);
+
+	// Approximate windows are summarized as they are, so every stream's
+	// sketch uses their epsilon
+	global_port = -1;
+	if (gepsilon > 0) {
+		global_eps = (epsilon > 0) ? epsilon : gepsilon;
+		global_port = ptcreate((num_streams < 16) ? num_streams : 16);
+		resume(create((void *) stream_aggregator, 4096, 20, "stream_aggregator", 1, num_streams));
+	}
 
   // Create consumer processes and initialize streams
   // Use `i` as the stream id.
-	char process_name[18];
+	char process_name[24];
+	if (num_consumers > 0) {
+		stream_states = (struct stream_state *) getmem(sizeof(struct stream_state) * num_streams);
+		memset(stream_states, 0, sizeof(struct stream_state) * num_streams);
+		shards = (struct stream_shard *) getmem(sizeof(struct stream_shard) * num_consumers);
+		for (i = 0; i < num_consumers; i++) {
+			shards[i].ready = semcreate(0);
+			shards[i].mutex = semcreate(1);
+			shards[i].freed = semcreate(0);
+			shards[i].pwaiting = FALSE;
+			shards[i].nstreams = (num_streams - i + num_consumers - 1) / num_consumers;
+			shards[i].fifo = (int32 *) getmem(sizeof(int32) * shards[i].nstreams);
+			shards[i].fhead = shards[i].ftail = 0;
+		}
+	} else {
+		shards = NULL;
+	}
   for (i = 0; i < num_streams; i++) {
-		streams[i].spaces = semcreate(work_queue_depth);
-		streams[i].items = semcreate(0);
-		streams[i].mutex = semcreate(1);
-		streams[i].head = 0;
-		streams[i].tail = 0;
-		streams[i].queue = (de *) getmem(sizeof(de) * work_queue_depth);
+		if (num_consumers > 0) {
+			streams[i].ring = NULL;
+			streams[i].head = 0;
+			streams[i].tail = 0;
+			streams[i].queue = (de *) getmem(sizeof(de) * work_queue_depth);
+			continue;
+		}
+		if (use_ring) {
+			streams[i].ring = spsc_alloc(sizeof(de), work_queue_depth);
+			if (streams[i].ring == NULL) panic("spsc_alloc failed");
+		} else {
+			streams[i].ring = NULL;
+			streams[i].spaces = semcreate(work_queue_depth);
+			streams[i].items = semcreate(0);
+			streams[i].mutex = semcreate(1);
+			streams[i].head = 0;
+			streams[i].tail = 0;
+			streams[i].queue = (de *) getmem(sizeof(de) * work_queue_depth);
+		}
 
 		sprintf(process_name, "stream_consumer_%d", i);
 		resume(create((void *) stream_consumer, 4096, 20, process_name, 2, i, &(streams[i])));
   }
+	for (i = 0; i < num_consumers; i++) {
+		sprintf(process_name, "stream_shard_%d", i);
+		resume(create((void *) stream_shard_consumer, 4096, 20, process_name, 2, i, &(shards[i])));
+	}
 
 	
-  // Parse input header file data and populate work queue
+  // Hand each input record to its stream's work queue
 	int st, ts, v;
-	char* a;
-	for (i = 0; i < n_input; i++) {
-		a = (char *) stream_input[i];
-		st = atoi(a);
-		while (*a++ != '\t');
-		ts = atoi(a);
-		while (*a++ != '\t');
-		v = atoi(a);
+
+	// In batch mode each stream stages up to batch_size records, then
+	// claims that many spaces with one waitn and publishes them with one
+	// signaln
+	de* pending = NULL;
+	int* npending = NULL;
+	if (batch_size > 1) {
+		pending = (de *) getmem(sizeof(de) * batch_size * num_streams);
+		npending = (int *) getmem(sizeof(int) * num_streams);
+		memset(npending, 0, sizeof(int) * num_streams);
+	}
+
+	for (i = 0; i < cols.nrecs; i++) {
+		st = cols.stream[i];
+		ts = cols.time[i];
+		v = cols.value[i];
+
+		if (pending != NULL) {
+			pending[(st * batch_size) + npending[st]].time = ts;
+			pending[(st * batch_size) + npending[st]].value = v;
+			pending[(st * batch_size) + npending[st]].stamp = stream_stamp();
+			if (++npending[st] == batch_size) {
+				stream_flush(&streams[st], &pending[st * batch_size], batch_size);
+				npending[st] = 0;
+			}
+			continue;
+		}
+
+		if (num_consumers > 0) {
+			stream_shard_put(st, ts, v);
+			continue;
+		}
+
+		if (use_ring) {
+			de elem = { ts, v, stream_stamp() };
+			spsc_put(streams[st].ring, (char *) &elem); // Blocks only while full
+			continue;
+		}
 
 		wait(streams[st].spaces); // Wait for an empty space to write to
 		wait(streams[st].mutex); // Grab the stream's mutex
 
 		((streams[st].queue)[streams[st].head]).time = ts;
 		((streams[st].queue)[streams[st].head]).value = v;
+		((streams[st].queue)[streams[st].head]).stamp = stream_stamp();
 		streams[st].head = (streams[st].head + 1) % work_queue_depth; // Increment the head
 
 		signal(streams[st].mutex); // Release the mutex
 		signal(streams[st].items); // Signal that there is another item available for consumption
 	}
+	if (pending != NULL) {
+		for (i = 0; i < num_streams; i++) {
+			stream_flush(&streams[i], &pending[i * batch_size], npending[i]);
+		}
+		freemem((char *) pending, sizeof(de) * batch_size * num_streams);
+		freemem((char *) npending, sizeof(int) * num_streams);
+	}
+
+	// Streams the input never mentions still need their closing record
+	for (st = cols.nstreams; st < num_streams; st++) {
+		de last = { 0, 0, 0 };
+		stream_flush(&streams[st], &last, 1);
+	}
 
   // Join all launched consumer processes
-	for (i = 0; i < num_streams; i++) {
-		// We would expect to receie `num_streams` messages from the port
-		kprintf("process %d exited\n", ptrecv(sync_port));
+	for (i = 0; i < nprocs; i++) {
+		// We would expect to receive `nprocs` messages from the port
+		stream_log("process %d exited\n", ptrecv(sync_port));
+	}
+	if (global_port != -1) {
+		stream_log("process %d exited\n", ptrecv(sync_port));
+		ptdelete(global_port, NULL);
+		global_port = -1;
 	}
 
   // Measure the time of this entire function and report it at the end
-	time = (((clktime * 1000) + clkticks) - ((secs * 1000) + msecs));
-	printf("time in ms: %u\n", time);
+	time = (ulong)udiv64(gettime_ns() - start_ns, 1000, NULL);
+	if (stream_bench == NULL) {
+		printf("time in ms: %u\n", time / 1000);
+		printf("time in us: %u\n", time);
+	}
 
 	// Free the queues in the streams (since they're on heap space) and the semaphores and the tscdfs
 	for (i = 0; i < num_streams; i++) {
-		semdelete(streams[i].spaces);
-		semdelete(streams[i].items);
-		semdelete(streams[i].mutex);
-		freemem((char *) streams[i].queue, sizeof(de) * work_queue_depth);
+		if (streams[i].ring != NULL) {
+			spsc_free(streams[i].ring);
+		} else if (num_consumers > 0) {
+			freemem((char *) streams[i].queue, sizeof(de) * work_queue_depth);
+		} else {
+			semdelete(streams[i].spaces);
+			semdelete(streams[i].items);
+			semdelete(streams[i].mutex);
+			freemem((char *) streams[i].queue, sizeof(de) * work_queue_depth);
+		}
 		tscdf_free(tscdf_arr[i]);
 	}
+	for (i = 0; i < num_consumers; i++) {
+		semdelete(shards[i].ready);
+		semdelete(shards[i].mutex);
+		semdelete(shards[i].freed);
+		freemem((char *) shards[i].fifo, sizeof(int32) * shards[i].nstreams);
+	}
+	if (num_consumers > 0) {
+		freemem((char *) shards, sizeof(struct stream_shard) * num_consumers);
+		freemem((char *) stream_states, sizeof(struct stream_state) * num_streams);
+	}
 	// Free the streams and tscdf ptrs from the heap
 	freemem((char *) streams, sizeof(struct stream) * num_streams);
 	freemem((char *) tscdf_arr, sizeof(struct tscdf *) * num_streams);
+	tscdf_cols_release(blob, blob_len, blob_mapped);
 	signal(run_command_done);
   return OK;
 }
@@ -146,46 +409,280 @@ int stream_proc(int nargs, char* args[]) {
 void stream_consumer(int32 id, struct stream *str) {
 
   //  Print the current id and pid
-	kprintf("stream_consumer id:%d (pid:%d)\n", id, currpid);
+	stream_log("stream_consumer id:%d (pid:%d)\n", id, currpid);
 
 	// Sanity check to make sure pointer to stream is valid
-	if (isbadsem(str->items) || isbadsem(str->spaces) || isbadsem(str->mutex)) panic("BAD STREAM (BAD SEM)");
+	if (str->ring == NULL && (isbadsem(str->items) || isbadsem(str->spaces) || isbadsem(str->mutex))) panic("BAD STREAM (BAD SEM)");
 
   // Consume all values from the work queue of the corresponding stream
-	int timestamp, value;
+	de elem;
 	int count = 0;
-	int32* qarray;
+	struct tscdf* tc = tscdf_arr[id];
+	struct tsketch* pub = stream_pub_init(tc); // Window summary for the aggregator
 	while(1) {
-		count++;
-
-		wait(str->items); // Wait for an item to read
-		wait(str->mutex); // grab the stream's mutex
+		if (str->ring != NULL) {
+			spsc_get(str->ring, (char *) &elem); // Blocks only while empty
+		} else {
+			wait(str->items); // Wait for an item to read
+			wait(str->mutex); // grab the stream's mutex
 
-		timestamp = ((str->queue)[str->tail]).time; // read from the tail
-		value = ((str->queue)[str->tail]).value;
-		str->tail = (str->tail + 1) % work_queue_depth;
+			elem = (str->queue)[str->tail]; // read from the tail
+			str->tail = (str->tail + 1) % work_queue_depth;
 
-		signal(str->mutex); // Release the mutex
-		signal(str->spaces); // Signal that a value has been consumed (so another space is free)
+			signal(str->mutex); // Release the mutex
+			signal(str->spaces); // Signal that a value has been consumed (so another space is free)
+		}
 
-		if (timestamp == 0 && value == 0) {
+		if (stream_record(id, &elem, &count, pub)) {
 			break;
 		}
+	}
+	stream_pub_done(id, tc, pub);
+	stream_log("stream_consumer exiting\n");
+	ptsend(sync_port, (umsg32) currpid);
+}
+
+// Serve every stream in a shard until each has sent its closing record
+void stream_shard_consumer(int32 id, struct stream_shard *sh) {
+	struct stream *str;
+	struct stream_state *ss;
+	de* buf;
+	int32 st, n, j, live;
+
+	stream_log("stream_shard_consumer id:%d (pid:%d)\n", id, currpid);
+
+	buf = (de *) getmem(sizeof(de) * work_queue_depth);
+	for (j = 0, st = id; j < sh->nstreams; j++, st += num_consumers) {
+		stream_states[st].pub = stream_pub_init(tscdf_arr[st]);
+	}
+
+	live = sh->nstreams;
+	while (live > 0) {
+		// Take the next stream with records and empty its queue in one go
+		wait(sh->ready);
+		wait(sh->mutex);
+		st = sh->fifo[sh->fhead];
+		sh->fhead = (sh->fhead + 1) % sh->nstreams;
+		str = &streams[st];
+		ss = &stream_states[st];
+		for (n = 0; n < ss->fill; n++) {
+			buf[n] = (str->queue)[str->tail];
+			str->tail = (str->tail + 1) % work_queue_depth;
+		}
+		ss->fill = 0;
+		ss->queued = FALSE;
+		if (sh->pwaiting) {
+			sh->pwaiting = FALSE;
+			signal(sh->freed);
+		}
+		signal(sh->mutex);
+
+		for (j = 0; j < n; j++) {
+			if (stream_record(st, &buf[j], &ss->count, ss->pub)) {
+				stream_pub_done(st, tscdf_arr[st], ss->pub);
+				live--;
+				break;
+			}
+		}
+	}
+	freemem((char *) buf, sizeof(de) * work_queue_depth);
+	stream_log("stream_shard_consumer exiting\n");
+	ptsend(sync_port, (umsg32) currpid);
+}
+
+// Producer side of -c: queue one record and make sure its stream is on
+// the shard's FIFO
+static void stream_shard_put(int32 st, int ts, int v) {
+	struct stream_shard *sh = &shards[st % num_consumers];
+	struct stream *str = &streams[st];
+	struct stream_state *ss = &stream_states[st];
+
+	wait(sh->mutex);
+	while (ss->fill == work_queue_depth) {
+		// Full: the stream is already in the FIFO, so wait for a drain
+		sh->pwaiting = TRUE;
+		signal(sh->mutex);
+		wait(sh->freed);
+		wait(sh->mutex);
+	}
+	((str->queue)[str->head]).time = ts;
+	((str->queue)[str->head]).value = v;
+	((str->queue)[str->head]).stamp = stream_stamp();
+	str->head = (str->head + 1) % work_queue_depth;
+	ss->fill++;
+	if (!ss->queued) {
+		ss->queued = TRUE;
+		sh->fifo[sh->ftail] = st;
+		sh->ftail = (sh->ftail + 1) % sh->nstreams;
+		signal(sh->ready);
+	}
+	signal(sh->mutex);
+}
+
+// Fold one record into stream id's window, reporting every output_time
+// records.  Returns TRUE for the stream's closing (0,0) record.
+static bool8 stream_record(int32 id, de* elem, int *count, struct tsketch *pub) {
+	struct tscdf* tc = tscdf_arr[id];
+	int32 qarray[5];
+
+	(*count)++;
+	if (elem->time == 0 && elem->value == 0) {
+		return TRUE;
+	}
+
+	tscdf_update(tc, elem->time, elem->value);
+	if (stream_bench != NULL) {
+		stream_bench_record(elem->stamp);
+	}
+	if (pub != NULL && pub != tc->sketch) {
+		tsketch_add(pub, elem->value);
+	}
+	if (*count == output_time) {
+		*count = 0; // Every interval, reported or not
+		if (pub != NULL) {
+			stream_publish(id, pub);
+		}
+		if (!tscdf_full(tc)) {
+			stream_log("We don't report when the window isn't full\n");
+			return FALSE;
+		}
+		tscdf_quantiles(tc, tscdf_quartile_ranks, qarray, 5);
+
+		stream_log("s%d: %d %d %d %d %d\n", id, qarray[0], qarray[1], qarray[2], qarray[3], qarray[4]);
+	}
+	return FALSE;
+}
+
+// The sketch a stream publishes with -g: its own window when that is
+// approximate, otherwise one kept alongside it
+static struct tsketch* stream_pub_init(struct tscdf *tc) {
+	if (global_port == -1) {
+		return NULL;
+	}
+	return (tc->sketch != NULL) ? tc->sketch : tsketch_init(tc->max_vals, global_eps);
+}
+
+static void stream_pub_done(int32 id, struct tscdf *tc, struct tsketch *pub) {
+	if (global_port != -1) {
+		stream_publish(id, NULL);
+		if (pub != NULL && pub != tc->sketch) {
+			tsketch_free(pub);
+		}
+	}
+}
 
-		tscdf_update(tscdf_arr[id], timestamp, value);
-		if (count == output_time) {
-			qarray = tscdf_quartiles(tscdf_arr[id]);
+// Copy n staged records into a stream's queue with one counted wait
+// (rings take them one by one, as they have no semaphores to batch)
+static void stream_flush(struct stream *str, de* buf, int n) {
+	int j;
+
+	if (n == 0) {
+		return;
+	}
+	if (num_consumers > 0) {
+		for (j = 0; j < n; j++) {
+			stream_shard_put(str - streams, buf[j].time, buf[j].value);
+		}
+		return;
+	}
+	if (str->ring != NULL) {
+		for (j = 0; j < n; j++) {
+			spsc_put(str->ring, (char *) &buf[j]);
+		}
+		return;
+	}
+	waitn(str->spaces, n); // Claim all n spaces at once
+	wait(str->mutex);
+	for (j = 0; j < n; j++) {
+		(str->queue)[str->head] = buf[j];
+		str->head = (str->head + 1) % work_queue_depth;
+	}
+	signal(str->mutex);
+	signaln(str->items, n); // Make all n available to the consumer
+}
 
-			if (qarray == NULL) {
-  			kprintf("tscdf_quartiles returned NULL\n");
-  			continue;
+// Hand a snapshot of sk (or NULL when the stream is done) to the aggregator
+static void stream_publish(int32 id, struct tsketch *sk) {
+	struct stream_summary *msg;
+
+	msg = (struct stream_summary *) getmem(sizeof(struct stream_summary));
+	if (msg == (struct stream_summary *) SYSERR) {
+		return;
+	}
+	msg->id = id;
+	msg->sk = NULL;
+	if (sk != NULL) {
+		msg->sk = tsketch_snapshot(sk);
+		if (msg->sk == NULL) {
+			freemem((char *) msg, sizeof(struct stream_summary));
+			return;
+		}
+	}
+	ptsend(global_port, (umsg32) msg);
+}
+
+void stream_aggregator(int32 num_streams) {
+	struct stream_summary *msg;
+	struct tsketch **latest; // Newest summary from each stream
+	struct tsketch *global;
+	bool8 *fresh; // Stream has reported since the last global output
+	int32 live = num_streams, nfresh = 0;
+	int32 qarray[6];
+	int32 i;
+
+	stream_log("stream_aggregator (pid:%d)\n", currpid);
+
+	latest = (struct tsketch **) getmem(sizeof(struct tsketch *) * num_streams);
+	fresh = (bool8 *) getmem(sizeof(bool8) * num_streams);
+	memset(latest, 0, sizeof(struct tsketch *) * num_streams);
+	memset(fresh, 0, sizeof(bool8) * num_streams);
+
+	while (live > 0) {
+		msg = (struct stream_summary *) ptrecv(global_port);
+		i = msg->id;
+		if (latest[i] != NULL) {
+			tsketch_free(latest[i]);
+		}
+		latest[i] = msg->sk;
+		freemem((char *) msg, sizeof(struct stream_summary));
+
+		if (latest[i] == NULL) {
+			live--;
+		}
+		if (fresh[i]) {
+			// Already counted this round: the stream simply reported again
+			if (latest[i] == NULL) {
+				nfresh--;
+				fresh[i] = FALSE;
 			}
+		} else if (latest[i] != NULL) {
+			fresh[i] = TRUE;
+			nfresh++;
+		}
 
-			kprintf("s%d: %d %d %d %d %d\n", id, qarray[0], qarray[1], qarray[2], qarray[3], qarray[4]);
-			freemem((char *) qarray, (6*sizeof(int32)));
-			count = 0;
+		// One output per round in which every live stream has reported
+		if (nfresh == 0 || nfresh < live) {
+			continue;
 		}
+		global = tsketch_init(1, global_eps);
+		if (global == NULL) {
+			continue;
+		}
+		for (i = 0; i < num_streams; i++) {
+			if (latest[i] != NULL) {
+				tsketch_merge(global, latest[i]);
+			}
+			fresh[i] = FALSE;
+		}
+		nfresh = 0;
+		if (tsketch_quantiles(global, global_ranks, qarray, 6) == OK) {
+			stream_log("global: %d %d %d %d %d p99 %d\n", qarray[0], qarray[1], qarray[2], qarray[3], qarray[5], qarray[4]);
+		}
+		tsketch_free(global);
 	}
-	kprintf("stream_consumer exiting\n");
+
+	freemem((char *) latest, sizeof(struct tsketch *) * num_streams);
+	freemem((char *) fresh, sizeof(bool8) * num_streams);
+	stream_log("stream_aggregator exiting\n");
 	ptsend(sync_port, (umsg32) currpid);
 }
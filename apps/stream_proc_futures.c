@@ -5,6 +5,7 @@
  * Date: 3/30/2022                                                        *
  **************************************************************************/
 #include "tscdf.h"
+#include "tscdf_cols.h"
 #include <stream.h>
 #include <future.h>
 #include <string.h>
@@ -12,24 +13,37 @@
 #include <run.h>
 
 void stream_consumer_future(int32 id, future_t* f);
+static void stream_flush_future(future_t* f, de* buf, int n);
 static struct tscdf** tscdf_arr; // An array of pointers to tscdf structs
 static int work_queue_depth, output_time;
+static int batch_size; // Elements per future_set_n/get_n call, 0 = zero-copy
+static de* batches; // batch_size elements per consumer for future_get_n
 static int32 sync_port;
 
 int stream_proc_futures(int nargs, char* args[]) {
-	ulong secs, msecs, time;
-	secs = clktime;
-	msecs = clkticks;
+	uint64 start_ns;
+	ulong time;
+	start_ns = gettime_ns();
 
   // Parse input
 	int num_streams = 0;
 	int time_window = 0;
+	bool8 time_based = FALSE; // -t 500t: values from the last 500 timestamp units
 
-	char usage[] = "run tscdf_fq -s <num_streams> -w <work_queue_depth> -t <time_window> -o <output_time>\n";
+	char usage[] = "run tscdf_fq -s <num_streams> -w <work_queue_depth> -t <time_window>[t] -o <output_time> [-b <batch>] [-a <epsilon>] [-i <file>]\n";
+
+	int32 epsilon = 0; // Approximate windows (-a) when nonzero, in ppm
+
+	char* input_file = NULL; // Packed input on the fs (-i), else the built-in one
+	struct tscdf_cols cols;
+	char* blob = NULL;
+	int32 blob_len = 0;
+	bool8 blob_mapped = FALSE; // blob is the file itself, mapped from the fs
 
 	int i;
 	char *ch, c;
-	if (nargs != 9) {
+	batch_size = 0;
+	if (nargs < 9 || nargs > 15 || (nargs % 2) == 0) {
 		printf("%s", usage);
 		signal(run_command_done);
 		return SYSERR;
@@ -50,12 +64,30 @@ int stream_proc_futures(int nargs, char* args[]) {
 
 				case 't':
 					time_window = atoi(args[i]);
+					time_based = (args[i][strlen(args[i]) - 1] == 't');
 					break;
 
 				case 'o':
 					output_time = atoi(args[i]);
 					break;
 
+				case 'a':
+					epsilon = tsketch_parse_epsilon(args[i]);
+					if (epsilon == SYSERR) {
+						printf("%s", usage);
+						signal(run_command_done);
+						return SYSERR;
+					}
+					break;
+
+				case 'b':
+					batch_size = atoi(args[i]);
+					break;
+
+				case 'i':
+					input_file = args[i];
+					break;
+
 				default:
 					printf("%s", usage);
 					signal(run_command_done);
@@ -66,13 +98,76 @@ int stream_proc_futures(int nargs, char* args[]) {
 		}
 	}	
 
+	// Sketches expire values by count, so they cannot follow a time window
+	if (time_based && epsilon > 0) {
+		printf("%s", usage);
+		signal(run_command_done);
+		return SYSERR;
+	}
+
+  // Load the input columns: records are read in place, with no parsing
+	if (input_file != NULL) {
+		blob = tscdf_cols_load(input_file, &blob_len, &blob_mapped);
+		if (blob == NULL || tscdf_cols_view(blob, blob_len, &cols) == SYSERR) {
+			printf("cannot load input file %s\n", input_file);
+			tscdf_cols_release(blob, blob_len, blob_mapped);
+			signal(run_command_done);
+			return SYSERR;
+		}
+	} else if (tscdf_cols_builtin(&cols) == SYSERR) {
+		printf("cannot convert the built-in input\n");
+		signal(run_command_done);
+		return SYSERR;
+	}
+	if (cols.nstreams > num_streams) {
+		printf("input has %d streams, only %d requested\n", cols.nstreams, num_streams);
+		tscdf_cols_release(blob, blob_len, blob_mapped);
+		signal(run_command_done);
+		return SYSERR;
+	}
+
+	// In batch mode each stream collects up to batch_size records before
+	// they are handed to its future in one future_set_n call.  The buffers
+	// for both ends are taken now, so a short heap fails the run before
+	// any consumer is waiting on its future.
+	de* pending = NULL;
+	int* npending = NULL;
+	batches = NULL;
+	if (batch_size > 0) {
+		pending = (de *) getmem(sizeof(de) * batch_size * num_streams);
+		npending = (int *) getmem(sizeof(int) * num_streams);
+		batches = (de *) getmem(sizeof(de) * batch_size * num_streams);
+		if (pending == (de *) SYSERR || npending == (int *) SYSERR || batches == (de *) SYSERR) {
+			printf("not enough memory for -b %d with %d streams\n", batch_size, num_streams);
+			if (pending != (de *) SYSERR) {
+				freemem((char *) pending, sizeof(de) * batch_size * num_streams);
+			}
+			if (npending != (int *) SYSERR) {
+				freemem((char *) npending, sizeof(int) * num_streams);
+			}
+			if (batches != (de *) SYSERR) {
+				freemem((char *) batches, sizeof(de) * batch_size * num_streams);
+			}
+			tscdf_cols_release(blob, blob_len, blob_mapped);
+			signal(run_command_done);
+			return SYSERR;
+		}
+		memset(npending, 0, sizeof(int) * num_streams);
+	}
+
   // Create futures and store pointers in the array "futures" 
 	future_t* futures[num_streams];
 
 	// Each stream/future needs a tscdf
 	tscdf_arr = (struct tscdf **) getmem(sizeof(struct tscdf *) * num_streams);
 	for (i = 0; i < num_streams; i++) {
-		tscdf_arr[i] = tscdf_init(time_window);
+		if (epsilon > 0) {
+			tscdf_arr[i] = tscdf_init_approx(time_window, epsilon);
+		} else if (time_based) {
+			tscdf_arr[i] = tscdf_init_time(time_window);
+		} else {
+			tscdf_arr[i] = tscdf_init(time_window);
+		}
 	}
 
 	sync_port = ptcreate(num_streams);
@@ -88,37 +183,67 @@ int stream_proc_futures(int nargs, char* args[]) {
   }
 
 	
-  // Parse input header file data and populate work queue
+  // Hand each input record to its stream's work queue
 	int st, ts, v;
-	char* a;
-	de* write_in = (de *) getmem(sizeof(de));
-	for (i = 0; i < n_input; i++) {
-		a = (char *) stream_input[i];
-		st = atoi(a);
-		while (*a++ != '\t');
-		ts = atoi(a);
-		while (*a++ != '\t');
-		v = atoi(a);
-
-		// Need to pass a pointer to copy into the future
-		write_in->time = ts;
-		write_in->value = v;
+	de* write_in;
 
-		if (future_set(futures[st], (char *)write_in) == SYSERR) { // write_in cast to char* (see future.h)
+	for (i = 0; i < cols.nrecs; i++) {
+		st = cols.stream[i];
+		ts = cols.time[i];
+		v = cols.value[i];
+
+		if (batch_size > 0) {
+			write_in = &pending[(st * batch_size) + npending[st]];
+			write_in->time = ts;
+			write_in->value = v;
+			write_in->stamp = stream_stamp();
+			if (++npending[st] == batch_size) {
+				stream_flush_future(futures[st], &pending[st * batch_size], batch_size);
+				npending[st] = 0;
+			}
+			continue;
+		}
+
+		// Fill the next free slot of the future in place
+		write_in = (de *) future_reserve(futures[st]);
+		if (write_in == (de *) SYSERR) {
 			kprintf("ERROR: failed writing value (%d, %d) to stream/future %d\n", ts, v, st);
+			continue;
+		}
+		write_in->time = ts;
+		write_in->value = v;
+		write_in->stamp = stream_stamp();
+		future_commit(futures[st]);
+	}
+	if (batch_size > 0) {
+		for (i = 0; i < num_streams; i++) {
+			stream_flush_future(futures[i], &pending[i * batch_size], npending[i]);
 		}
+		freemem((char *) pending, sizeof(de) * batch_size * num_streams);
+		freemem((char *) npending, sizeof(int) * num_streams);
+	}
+
+	// Streams the input never mentions still need their closing record
+	for (st = cols.nstreams; st < num_streams; st++) {
+		de last = { 0, 0, 0 };
+		stream_flush_future(futures[st], &last, 1);
 	}
-	freemem((char*)write_in, sizeof(de));
 
   // Join all launched consumer processes
 	for (i = 0; i < num_streams; i++) {
 		// We would expect to receive `num_streams` messages from the port
-		kprintf("process %d exited\n", ptrecv(sync_port));
+		stream_log("process %d exited\n", ptrecv(sync_port));
+	}
+	if (batches != NULL) {
+		freemem((char *) batches, sizeof(de) * batch_size * num_streams);
 	}
 
   // Measure the time of this entire function and report it at the end
-	time = (((clktime * 1000) + clkticks) - ((secs * 1000) + msecs));
-	printf("time in ms: %u\n", time);
+	time = (ulong)udiv64(gettime_ns() - start_ns, 1000, NULL);
+	if (stream_bench == NULL) {
+		printf("time in ms: %u\n", time / 1000);
+		printf("time in us: %u\n", time);
+	}
 
 	// Free the futures and tscdfs
 	for (i = 0; i < num_streams; i++) {
@@ -127,6 +252,7 @@ int stream_proc_futures(int nargs, char* args[]) {
 	}
 	// Free the tscdf ptrs from the heap
 	freemem((char *) tscdf_arr, sizeof(struct tscdf *) * num_streams);
+	tscdf_cols_release(blob, blob_len, blob_mapped);
 	signal(run_command_done);
   return OK;
 }
@@ -134,43 +260,84 @@ int stream_proc_futures(int nargs, char* args[]) {
 void stream_consumer_future(int32 id, future_t* f) {
 
   //  Print the current id and pid
-	kprintf("stream_consumer_future id:%d (pid:%d)\n", id, currpid);
+	stream_log("stream_consumer_future id:%d (pid:%d)\n", id, currpid);
 
   // Consume all values from the future until we receive a (0,0) timestamp/value pair
 	int timestamp, value;
+	uint32 stamp;
 	int count = 0;
-	int32* qarray;
-	de* copy_out = (de *) getmem(sizeof(de));
+	int32 qarray[5];
+	struct tscdf* tc = tscdf_arr[id];
+	de* elem;
+	de* batch = NULL;
+	int got = 0, next = 0;
+	if (batch_size > 0) {
+		batch = &batches[id * batch_size];
+	}
 	while(1) {
 		count++;
 
-		// Read the data_element from the future
-		if ((future_get(f, (char*)copy_out)) == SYSERR) {
-			kprintf("ERROR: failed getting value in consumer w/ id %d", id);
+		if (batch_size > 0) {
+			// Refill the local batch once every element in it is used
+			if (next == got) {
+				got = future_get_n(f, (char *) batch, batch_size);
+				next = 0;
+				if (got == SYSERR) {
+					kprintf("ERROR: failed getting value in consumer w/ id %d", id);
+					break;
+				}
+			}
+			timestamp = batch[next].time;
+			value = batch[next].value;
+			stamp = batch[next].stamp;
+			next++;
+		} else {
+			// Read the data_element in place, then hand the slot back
+			elem = (de *) future_peek(f);
+			if (elem == (de *) SYSERR) {
+				kprintf("ERROR: failed getting value in consumer w/ id %d", id);
+				break;
+			}
+			timestamp = elem->time;
+			value = elem->value;
+			stamp = elem->stamp;
+			future_release(f);
 		}
-		// copy_out should now be populated with the data.
-		timestamp = copy_out->time;
-		value = copy_out->value;
 
 		if (timestamp == 0 && value == 0) {
 			break;
 		}
 
 		tscdf_update(tscdf_arr[id], timestamp, value);
+		if (stream_bench != NULL) {
+			stream_bench_record(stamp);
+		}
 		if (count == output_time) {
-			qarray = tscdf_quartiles(tscdf_arr[id]);
-
-			if (qarray == NULL) {
-  			kprintf("tscdf_quartiles returned NULL\n");
-  			continue;
+			count = 0; // Every interval, reported or not
+			if (!tscdf_full(tc)) {
+				stream_log("We don't report when the window isn't full\n");
+				continue;
 			}
+			tscdf_quantiles(tc, tscdf_quartile_ranks, qarray, 5);
 
-			kprintf("s%d: %d %d %d %d %d\n", id, qarray[0], qarray[1], qarray[2], qarray[3], qarray[4]);
-			freemem((char *) qarray, (6*sizeof(int32)));
-			count = 0;
+			stream_log("s%d: %d %d %d %d %d\n", id, qarray[0], qarray[1], qarray[2], qarray[3], qarray[4]);
 		}
 	}
-	freemem((char *)copy_out, sizeof(de));
-	kprintf("stream_consumer_future exiting\n");
+	stream_log("stream_consumer_future exiting\n");
 	ptsend(sync_port, (umsg32) currpid);
 }
+
+// Hand n buffered records to a future, calling future_set_n again whenever
+// the queue only had room for part of them.
+static void stream_flush_future(future_t* f, de* buf, int n) {
+	int32 moved;
+	while (n > 0) {
+		moved = future_set_n(f, (char *) buf, n);
+		if (moved == SYSERR) {
+			kprintf("ERROR: failed writing %d values to future\n", n);
+			return;
+		}
+		buf += moved;
+		n -= moved;
+	}
+}
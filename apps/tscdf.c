@@ -1,17 +1,43 @@
 #include "tscdf.h"
 
+static void tscdf_list_insert(struct tscdf *tc, struct tscdf_element *te);
+static void tscdf_list_remove(struct tscdf *tc, struct tscdf_element *te);
+static void tscdf_list_select(struct tscdf *tc, const int32 *ranks,
+                              struct tscdf_element **out, int32 n);
+static struct tscdf_element *tscdf_list_succ(struct tscdf *tc,
+                                             struct tscdf_element *te);
+static struct tscdf_element *tscdf_list_pred(struct tscdf *tc,
+                                             struct tscdf_element *te);
+static void tscdf_cursors_remove(struct tscdf *tc, struct tscdf_element *te);
+static void tscdf_cursors_insert(struct tscdf *tc, struct tscdf_element *te);
+static int32 tscdf_target(struct tscdf *tc, int32 permille);
+static void tscdf_evict(struct tscdf *tc);
+static int32 tscdf_grow(struct tscdf *tc);
+
+const int32 tscdf_quartile_ranks[5] = { 0, 250, 500, 750, 1000 };
+
+const struct tscdf_backend tscdf_list_backend = {
+  tscdf_list_insert, tscdf_list_remove, tscdf_list_select,
+  tscdf_list_succ, tscdf_list_pred
+};
+
 struct tscdf *
 tscdf_init(int maxvals) {
+  return tscdf_init_backend(maxvals, &tscdf_tree_backend);
+}
+
+struct tscdf *
+tscdf_init_backend(int maxvals, const struct tscdf_backend *backend) {
   struct tscdf *new_tscdf;
 
-  new_tscdf = (struct tscdf *)getmem(sizeof(struct tscdf));
+  new_tscdf = (struct tscdf *)getslab(sizeof(struct tscdf));
 
   if (new_tscdf == (struct tscdf *)SYSERR) {
     printf("tscdf: getmem failed\n");
     return(NULL);
   }
 
-  new_tscdf->data = (struct tscdf_element *)getmem(maxvals 
+  new_tscdf->data = (struct tscdf_element *)getslab(maxvals 
                      * sizeof(struct tscdf_element));
 
   if (new_tscdf->data == (struct tscdf_element *)SYSERR) {
@@ -24,6 +50,11 @@ tscdf_init(int maxvals) {
   new_tscdf->max_vals = maxvals;
   new_tscdf->num_vals = 0;
   new_tscdf->newest = -1;
+  new_tscdf->backend = backend;
+  new_tscdf->seed = 2463534242UL;
+  new_tscdf->ncursors = 0;
+  new_tscdf->sketch = NULL;
+  new_tscdf->span = 0;
   if ((new_tscdf->mutex = semcreate(1)) == SYSERR) {
       printf("tscdf: semcreate failed\n");
       return(NULL);
@@ -33,14 +64,77 @@ tscdf_init(int maxvals) {
   
 }
 
+/*
+ * A window that keeps only an approximate sketch of its values: memory
+ * no longer grows with maxvals, and quantiles are within epsilon_ppm
+ * (parts per million) of a value in the window.
+ */
+struct tscdf *
+tscdf_init_approx(int maxvals, int32 epsilon_ppm) {
+  struct tscdf *new_tscdf;
+
+  new_tscdf = (struct tscdf *)getslab(sizeof(struct tscdf));
+
+  if (new_tscdf == (struct tscdf *)SYSERR) {
+    printf("tscdf: getmem failed\n");
+    return(NULL);
+  }
+
+  new_tscdf->sketch = tsketch_init(maxvals, epsilon_ppm);
+  if (new_tscdf->sketch == NULL) {
+    printf("tscdf: tsketch_init failed\n");
+    freeslab((char *)new_tscdf, sizeof(struct tscdf));
+    return(NULL);
+  }
+
+  new_tscdf->data = NULL;
+  new_tscdf->vhead = new_tscdf->vtail = NULL;
+  new_tscdf->max_vals = maxvals;
+  new_tscdf->num_vals = 0;
+  new_tscdf->newest = -1;
+  new_tscdf->backend = NULL;
+  new_tscdf->ncursors = 0;
+  new_tscdf->span = 0;
+  if ((new_tscdf->mutex = semcreate(1)) == SYSERR) {
+      printf("tscdf: semcreate failed\n");
+      return(NULL);
+  }
+
+  return (new_tscdf);
+}
+
+/*
+ * A window of the values whose timestamps are within span of the newest
+ * one, however many that is.  tc->data starts small and doubles when a
+ * burst fills it, so max_vals is only its current capacity.
+ */
+struct tscdf *
+tscdf_init_time(int span) {
+  struct tscdf *new_tscdf;
+
+  if (span <= 0) {
+    return(NULL);
+  }
+  new_tscdf = tscdf_init_backend(TSCDF_TIME_INIT, &tscdf_tree_backend);
+  if (new_tscdf != NULL) {
+    new_tscdf->span = span;
+  }
+  return (new_tscdf);
+}
+
 int32
 tscdf_free(struct tscdf *tc) {
 
   semdelete(tc->mutex);
 
-  freemem((char *)tc->data, tc->max_vals * sizeof(struct tscdf_element));
+  if (tc->sketch != NULL) {
+    tsketch_free(tc->sketch);
+  }
+  else {
+    freeslab((char *)tc->data, tc->max_vals * sizeof(struct tscdf_element));
+  }
 
-  freemem((char *)tc, sizeof(struct tscdf));
+  freeslab((char *)tc, sizeof(struct tscdf));
 
   return(OK);
 }
@@ -49,71 +143,164 @@ tscdf_free(struct tscdf *tc) {
 /* insert a new value and remove the oldest one */
 int
 tscdf_update(struct tscdf *tc, int timestamp, int value) {
-  struct tscdf_element *new_te, *old_te, *tte, *ttep;
+  struct tscdf_element *new_te;
 
   if (tc == NULL) { return SYSERR; }
 
-  tc->newest = (tc->newest + 1) % tc->max_vals;
-
-  old_te = &tc->data[tc->newest];
+  if (tc->sketch != NULL) {
+    wait(tc->mutex);
+    tsketch_add(tc->sketch, value);
+    /* num_vals only says whether the window has filled yet */
+    if (tc->num_vals < tc->max_vals) {
+      tc->num_vals++;
+    }
+    signal(tc->mutex);
+    return(OK);
+  }
 
   wait(tc->mutex);
 
-  /* full queue -- the steady state */
-  if (tc->num_vals == tc->max_vals) {
-
-    /* remove from value list */
-    if (old_te->vnext == NULL) {
-      /* then it was vhead */
-      old_te->vprev->vnext = NULL;
-      tc->vhead = old_te->vprev;
-    }
-    else {
-      old_te->vnext->vprev = old_te->vprev;
+  if (tc->span > 0) {
+    if (tc->newest == -1) {
+      tc->first_ts = timestamp;
     }
-    if (old_te->vprev == NULL) {
-      /* then it was vtail */
-      old_te->vnext->vprev = NULL;
-      tc->vtail = old_te->vnext;
+    tc->newest_ts = timestamp;
+    /* drop everything that has aged out: each value leaves only once,
+       so a burst of evictions still averages O(log window) per update */
+    while (tc->num_vals > 0
+           && tc->data[(tc->newest + 1 + tc->max_vals - tc->num_vals)
+                       % tc->max_vals].timestamp < timestamp - tc->span) {
+      tscdf_evict(tc);
     }
-    else {
-      old_te->vprev->vnext = old_te->vnext;
+    if (tc->num_vals == tc->max_vals && tscdf_grow(tc) == SYSERR) {
+      tscdf_evict(tc);
     }
-    
-    tc->num_vals--;
+  }
+  /* full queue -- the steady state: the slot holds the oldest value */
+  else if (tc->num_vals == tc->max_vals) {
+    tscdf_evict(tc);
   }
 
-  /* now copy values into tc->data[tc->newest] */
-  new_te = old_te;
+  tc->newest = (tc->newest + 1) % tc->max_vals;
+  new_te = &tc->data[tc->newest];
 
+  /* now copy values into tc->data[tc->newest] */
   new_te->vprev = new_te->vnext = NULL;
   new_te->timestamp = timestamp;
   new_te->value = value;
 
+  tc->backend->insert(tc, new_te);
+  tc->num_vals++;
+  tscdf_cursors_insert(tc, new_te);
+  signal(tc->mutex);
+
+  return(OK);
+}
+
+/* remove the oldest value from the window */
+static void
+tscdf_evict(struct tscdf *tc) {
+  struct tscdf_element *old_te;
+
+  old_te = &tc->data[(tc->newest + 1 + tc->max_vals - tc->num_vals)
+                     % tc->max_vals];
+  tscdf_cursors_remove(tc, old_te);
+  tc->backend->remove(tc, old_te);
+  tc->num_vals--;
+}
+
+/* double tc->data, moving the window to the front oldest first; the
+   elements move, so the backend is rebuilt and cursors are placed again */
+static int32
+tscdf_grow(struct tscdf *tc) {
+  struct tscdf_element *data, *te;
+  int32 i, oldest;
+
+  data = (struct tscdf_element *)getslab(2 * tc->max_vals
+                                         * sizeof(struct tscdf_element));
+  if (data == (struct tscdf_element *)SYSERR) {
+    return SYSERR;
+  }
+  oldest = (tc->newest + 1 + tc->max_vals - tc->num_vals) % tc->max_vals;
+  for (i = 0; i < tc->num_vals; i++) {
+    data[i] = tc->data[(oldest + i) % tc->max_vals];
+  }
+  freeslab((char *)tc->data, tc->max_vals * sizeof(struct tscdf_element));
+
+  tc->data = data;
+  tc->max_vals *= 2;
+  tc->newest = tc->num_vals - 1;
+  tc->vhead = tc->vtail = NULL;
+  for (i = 0; i < tc->num_vals; i++) {
+    te = &tc->data[i];
+    te->vprev = te->vnext = NULL;
+    tc->backend->insert(tc, te);
+  }
+  tc->ncursors = 0;
+  return OK;
+}
+
+/*
+ * Give up the mutex of a window that only one process will ever touch,
+ * so that thousands of windows do not exhaust the semaphore table.
+ * wait() and signal() on the resulting SYSERR id return at once.
+ */
+void
+tscdf_private(struct tscdf *tc) {
+  semdelete(tc->mutex);
+  tc->mutex = SYSERR;
+}
+
+/* has the window seen enough values to be reported? */
+bool8
+tscdf_full(struct tscdf *tc) {
+  if (tc->span > 0) {
+    return tc->num_vals > 0 && tc->newest_ts - tc->first_ts >= tc->span;
+  }
+  return tc->num_vals == tc->max_vals;
+}
+
+/* sorted doubly linked list: vtail is the smallest value, vhead the largest */
+static void
+tscdf_list_remove(struct tscdf *tc, struct tscdf_element *old_te) {
+  if (old_te->vnext == NULL) {
+    /* then it was vhead */
+    tc->vhead = old_te->vprev;
+  }
+  else {
+    old_te->vnext->vprev = old_te->vprev;
+  }
+  if (old_te->vprev == NULL) {
+    /* then it was vtail */
+    tc->vtail = old_te->vnext;
+  }
+  else {
+    old_te->vprev->vnext = old_te->vnext;
+  }
+}
+
+static void
+tscdf_list_insert(struct tscdf *tc, struct tscdf_element *new_te) {
+  struct tscdf_element *tte, *ttep;
+
   /* first element in the list */
   if (tc->vhead == NULL) {
     tc->vhead = tc->vtail = new_te;
-    tc->num_vals++;
-    signal(tc->mutex);
-    return(OK);
+    return;
   }
 
-  /* insert new element in sorted value list */
-
   /* new lowest value.  insert at ttail and we are finished. */
-  if(value <= tc->vtail->value) {
+  if(tscdf_before(new_te, tc->vtail)) {
     new_te->vnext = tc->vtail;
     tc->vtail->vprev = new_te;
     tc->vtail = new_te;
-    tc->num_vals++;
-    signal(tc->mutex);
-    return(OK);
+    return;
   }
-  
+
   tte = tc->vtail;
   ttep = NULL;
 
-  while(tte != NULL && tte->value < value) {
+  while(tte != NULL && tscdf_before(tte, new_te)) {
     ttep = tte;
     tte = tte->vnext;
   }
@@ -128,23 +315,169 @@ tscdf_update(struct tscdf *tc, int timestamp, int value) {
   else {
     tc->vhead = new_te;
   }
-  
-  tc->num_vals++;
-  signal(tc->mutex);
+}
 
-  return(OK);
+/* one walk from the smallest value picks up every requested rank */
+static void
+tscdf_list_select(struct tscdf *tc, const int32 *ranks,
+                  struct tscdf_element **out, int32 n) {
+  struct tscdf_element *te = tc->vtail;
+  int32 i = 0, r;
+
+  for (r = 0; r < n; r++) {
+    while (i < ranks[r]) {
+      te = te->vnext;
+      i++;
+    }
+    out[r] = te;
+  }
+}
+
+static struct tscdf_element *
+tscdf_list_succ(struct tscdf *tc, struct tscdf_element *te) {
+  return te->vnext;
+}
+
+static struct tscdf_element *
+tscdf_list_pred(struct tscdf *tc, struct tscdf_element *te) {
+  return te->vprev;
+}
+
+/* rank of a quantile in the current window */
+static int32
+tscdf_target(struct tscdf *tc, int32 permille) {
+  int32 rank;
+
+  rank = (int32)udiv64((uint64)permille * tc->num_vals, 1000, NULL);
+  return (rank < tc->num_vals) ? rank : tc->num_vals - 1;
+}
+
+/* te is about to leave the window: keep every cursor on a live element */
+static void
+tscdf_cursors_remove(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_cursor *cur;
+  struct tscdf_element *next;
+  int32 i;
+
+  for (i = 0; i < tc->ncursors; i++) {
+    cur = &tc->cursors[i];
+    if (cur->te == te) {
+      /* the successor slides down into te's rank */
+      next = tc->backend->succ(tc, te);
+      if (next == NULL) {
+        next = tc->backend->pred(tc, te);
+        cur->rank--;
+      }
+      cur->te = next;
+    }
+    else if (tscdf_before(te, cur->te)) {
+      cur->rank--;
+    }
+  }
+}
+
+/* te has joined the window: account for it and step each cursor back
+   to its quantile, which moves it by at most a rank or two */
+static void
+tscdf_cursors_insert(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_cursor *cur;
+  int32 i, target;
+
+  for (i = 0; i < tc->ncursors; i++) {
+    cur = &tc->cursors[i];
+    if (cur->te == NULL) {
+      cur->te = te;
+      cur->rank = 0;
+    }
+    else if (tscdf_before(te, cur->te)) {
+      cur->rank++;
+    }
+    target = tscdf_target(tc, cur->permille);
+    while (cur->rank < target) {
+      cur->te = tc->backend->succ(tc, cur->te);
+      cur->rank++;
+    }
+    while (cur->rank > target) {
+      cur->te = tc->backend->pred(tc, cur->te);
+      cur->rank--;
+    }
+  }
+}
+
+/*
+ * Write the value at each requested quantile (in permille, 0-1000) to
+ * out.  The first request for a quantile places a cursor on it with one
+ * search; from then on tscdf_update keeps it in place, so the report
+ * itself is O(n).  Quantiles beyond TSCDF_NCURSOR are searched for each
+ * time.
+ */
+int32
+tscdf_quantiles(struct tscdf *tc, const int32 *ranks_permille, int32 *out,
+                int32 n) {
+  struct tscdf_cursor *cur;
+  struct tscdf_element *te;
+  int32 i, j, rank;
+
+  if (tc == NULL || n < 0) { return SYSERR; }
+
+  wait(tc->mutex);
+  if (tc->num_vals == 0) {
+    signal(tc->mutex);
+    return SYSERR;
+  }
+
+  if (tc->sketch != NULL) {
+    i = tsketch_quantiles(tc->sketch, ranks_permille, out, n);
+    signal(tc->mutex);
+    return i;
+  }
+
+  for (i = 0; i < n; i++) {
+    if (ranks_permille[i] < 0 || ranks_permille[i] > 1000) {
+      signal(tc->mutex);
+      return SYSERR;
+    }
+    for (j = 0; j < tc->ncursors; j++) {
+      if (tc->cursors[j].permille == ranks_permille[i]) {
+        break;
+      }
+    }
+    if (j < tc->ncursors) {
+      out[i] = tc->cursors[j].te->value;
+      continue;
+    }
+
+    rank = tscdf_target(tc, ranks_permille[i]);
+    tc->backend->select(tc, &rank, &te, 1);
+    out[i] = te->value;
+
+    /* start tracking this quantile if there is room */
+    if (tc->ncursors < TSCDF_NCURSOR) {
+      cur = &tc->cursors[tc->ncursors++];
+      cur->permille = ranks_permille[i];
+      cur->rank = rank;
+      cur->te = te;
+    }
+  }
+  signal(tc->mutex);
+  return OK;
 }
 
 /* this should return a null-terminated array of ints */
 int *
 tscdf_walk(struct tscdf *tc) {
   struct tscdf_element *te;
-  
-  te = tc->vtail;
+  int32 i;
+
+  if (tc->sketch != NULL) {
+    kprintf("(%d) approximate window: values are not kept\n", currpid);
+    return(0);
+  }
+
   kprintf("(%d) values: ", currpid);
-  while(te != NULL) {
+  for (i = 0; i < tc->num_vals; i++) {
+    tc->backend->select(tc, &i, &te, 1);
     kprintf("%d ", te->value);
-    te = te->vnext;
   }
   kprintf("\n");
 
@@ -164,21 +497,27 @@ int32 *
 tscdf_quartiles(struct tscdf *tc) {
   int32 q1, med, q3;
   int32 *qout;
+  int32 ranks[5];
+  struct tscdf_element *tes[5];
   int32 i;
-  struct tscdf_element *te;
 
-  if(tc->num_vals < tc->max_vals) {
+  if(!tscdf_full(tc)) {
     printf("We don't report when the window isn't full\n");
     return(NULL);
   }
 
-  qout = (int32 *)getmem(6 * sizeof(int32));
+  qout = (int32 *)getslab(6 * sizeof(int32));
   if (qout == (int32 *)SYSERR) {
     printf("getmem failed\n");return(NULL);
   }
 
   qout[5] = NULL;
 
+  if (tc->sketch != NULL || tc->span > 0) {
+    tscdf_quantiles(tc, tscdf_quartile_ranks, qout, 5);
+    return(qout);
+  }
+
   /* if we are referring to ordinal numbers */
   /*
   q1 = (tc->max_vals / 4) + 1;j
@@ -195,31 +534,14 @@ tscdf_quartiles(struct tscdf *tc) {
   q3 = q1 + med;
 
   //printf("nv: %d: %d, %d, %d\n", tc->max_vals, q1, med, q3);
-  te = tc->vtail;
-  
-  for(i=0; i < tc->max_vals; i++) {
-    
-    if(i==0) {
-      qout[0] = te->value;
-    }
-  
-    if(i==q1) {
-      qout[1] = te->value;
-    }
-    
-    if(i==med) {
-      qout[2] = te->value;
-    }
-    
-    if(i==q3) {
-      qout[3] = te->value;
-    }
-    
-    if(i==tc->max_vals - 1) {
-      qout[4] = te->value;
-    }
- 
-    te = te->vnext;
+  ranks[0] = 0;
+  ranks[1] = q1;
+  ranks[2] = med;
+  ranks[3] = q3;
+  ranks[4] = tc->max_vals - 1;
+  tc->backend->select(tc, ranks, tes, 5);
+  for (i = 0; i < 5; i++) {
+    qout[i] = tes[i]->value;
   }
 
 #if 0
@@ -257,7 +579,7 @@ tscdf_test(int nargs, char *args[]) {
   }
   printf("\n");
 
-  freemem((char *)qarray, (6*sizeof(int32)));
+  freeslab((char *)qarray, (6*sizeof(int32)));
 
   return(OK);
 
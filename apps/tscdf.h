@@ -1,36 +1,111 @@
 #include <xinu.h>
+#include "tsketch.h"
 
 extern const char *stream_input[];
 extern int32 n_input;
 
+/*
+ * Each window element is linked into a value-ordered structure owned by
+ * the tscdf backend.  vprev always leads toward smaller values and vnext
+ * toward larger ones: they are the neighbours in the sorted list backend
+ * and the left/right children in the tree backend.
+ */
 struct tscdf_element {
   int32 timestamp;
   int32 value;
   struct tscdf_element *vnext;
   struct tscdf_element *vprev;
+  int32 vsize;   /* tree: elements in this subtree */
+  uint32 vprio;  /* tree: heap priority */
+};
+
+/* Window order: by value, with equal values ordered by slot in tc->data */
+#define tscdf_before(a, b) ((a)->value < (b)->value || \
+                            ((a)->value == (b)->value && (a) < (b)))
+
+struct tscdf;
+
+/* Value-ordered structure behind a tscdf window */
+struct tscdf_backend {
+  void (*insert)(struct tscdf *tc, struct tscdf_element *te);
+  void (*remove)(struct tscdf *tc, struct tscdf_element *te);
+  /* element at each 0-based rank; ranks must be in ascending order */
+  void (*select)(struct tscdf *tc, const int32 *ranks,
+                 struct tscdf_element **out, int32 n);
+  /* neighbours of te in window order, or NULL */
+  struct tscdf_element *(*succ)(struct tscdf *tc, struct tscdf_element *te);
+  struct tscdf_element *(*pred)(struct tscdf *tc, struct tscdf_element *te);
+};
+
+extern const struct tscdf_backend tscdf_list_backend;  /* O(window) */
+extern const struct tscdf_backend tscdf_tree_backend;  /* O(log window) */
+
+/*
+ * A quantile that tscdf_update keeps positioned: te is the element at
+ * rank, and rank is stepped toward permille * num_vals / 1000 as values
+ * enter and leave the window, so reporting it needs no search.
+ */
+#define TSCDF_NCURSOR 8
+
+struct tscdf_cursor {
+  int32 permille;
+  int32 rank;
+  struct tscdf_element *te;
 };
 
 struct tscdf {
   struct tscdf_element *data;
-  struct tscdf_element *vhead;
-  struct tscdf_element *vtail;
+  struct tscdf_element *vhead;  /* list: largest value; tree: root */
+  struct tscdf_element *vtail;  /* list: smallest value */
   int32 newest;
   int32 max_vals;
   int32 num_vals;
-  sid32 mutex;
+  sid32 mutex;                  /* SYSERR after tscdf_private */
+  const struct tscdf_backend *backend;
+  uint32 seed;                  /* tree: priority generator state */
+  int32 ncursors;
+  struct tscdf_cursor cursors[TSCDF_NCURSOR];
+  struct tsketch *sketch;       /* approximate mode: used instead of data */
+  int32 span;                   /* time window length, 0 for count windows */
+  int32 first_ts;               /* time: timestamps of the first and */
+  int32 newest_ts;              /*   newest values seen */
 };
 
+#define TSCDF_TIME_INIT 64      /* initial capacity of a time window */
+
 struct tscdf *
 tscdf_init(int maxvals);
 
+struct tscdf *
+tscdf_init_backend(int maxvals, const struct tscdf_backend *backend);
+
+struct tscdf *
+tscdf_init_time(int span);
+
+struct tscdf *
+tscdf_init_approx(int maxvals, int32 epsilon_ppm);
+
 int32
 tscdf_free(struct tscdf *tc);
 
 int32
 tscdf_update(struct tscdf *tc, int timestamp, int value);
 
+void
+tscdf_private(struct tscdf *tc);
+
+bool8
+tscdf_full(struct tscdf *tc);
+
 int32 *
 tscdf_walk(struct tscdf *tc);
 
 int32 *
 tscdf_quartiles(struct tscdf *tc);
+
+int32
+tscdf_quantiles(struct tscdf *tc, const int32 *ranks_permille, int32 *out,
+                int32 n);
+
+/* min, q1, median, q3 and max for tscdf_quantiles */
+extern const int32 tscdf_quartile_ranks[5];
@@ -0,0 +1,233 @@
+#include "tscdf_cols.h"
+#include "tscdf.h"
+#include <stream.h>
+#include <stdlib.h>
+#include <run.h>
+#if FS
+#include <fs.h>
+#endif
+
+static char *builtin_blob = NULL;  /* stream_input, converted on first use */
+static int32 builtin_len;
+
+/*
+ * point cols at the columns of blob after checking it: a file given with
+ * -i is not trusted, since stream ids index the producers' arrays
+ */
+int32
+tscdf_cols_view(const char *blob, int32 len, struct tscdf_cols *cols) {
+  const struct tscdf_cols_hdr *hdr = (const struct tscdf_cols_hdr *)blob;
+  const int32 *base;
+  int32 i;
+
+  if (len < (int32)sizeof(struct tscdf_cols_hdr) || hdr->magic != TSCDF_COLS_MAGIC
+      || hdr->nrecs < 0 || hdr->nstreams < 0
+      /* compare by division so a huge nrecs can't wrap the size */
+      || hdr->nrecs > (len - (int32)sizeof(struct tscdf_cols_hdr)) / (3 * (int32)sizeof(int32))) {
+    return SYSERR;
+  }
+  base = (const int32 *)(hdr + 1);
+  for (i = 0; i < hdr->nrecs; i++) {
+    if (base[i] < 0 || base[i] >= hdr->nstreams) {
+      return SYSERR;
+    }
+  }
+  cols->nrecs = hdr->nrecs;
+  cols->nstreams = hdr->nstreams;
+  cols->stream = base;
+  cols->time = base + hdr->nrecs;
+  cols->value = base + 2 * hdr->nrecs;
+  return OK;
+}
+
+/* pack "stream\ttime\tvalue" lines into a new blob of *len bytes */
+char *
+tscdf_cols_convert(const char *lines[], int32 n, int32 *len) {
+  struct tscdf_cols_hdr *hdr;
+  int32 *stream, *time, *value;
+  char *a;
+  char *blob;
+  int32 i;
+
+  *len = tscdf_cols_size(n);
+  blob = getmem(*len);
+  if (blob == (char *)SYSERR) {
+    return NULL;
+  }
+  hdr = (struct tscdf_cols_hdr *)blob;
+  hdr->magic = TSCDF_COLS_MAGIC;
+  hdr->nrecs = n;
+  hdr->nstreams = 0;
+  hdr->reserved = 0;
+  stream = (int32 *)(hdr + 1);
+  time = stream + n;
+  value = stream + 2 * n;
+
+  for (i = 0; i < n; i++) {
+    a = (char *) lines[i];
+    stream[i] = atoi(a);
+    while (*a++ != '\t');
+    time[i] = atoi(a);
+    while (*a++ != '\t');
+    value[i] = atoi(a);
+    if (stream[i] >= hdr->nstreams) {
+      hdr->nstreams = stream[i] + 1;
+    }
+  }
+  return blob;
+}
+
+/* the compiled-in input; only the first call pays for parsing it */
+int32
+tscdf_cols_builtin(struct tscdf_cols *cols) {
+  intmask mask;
+  char *blob;
+  int32 len;
+
+  if (builtin_blob == NULL) {
+    blob = tscdf_cols_convert(stream_input, n_input, &len);
+    if (blob == NULL) {
+      return SYSERR;
+    }
+    mask = disable();
+    if (builtin_blob == NULL) {
+      builtin_blob = blob;
+      builtin_len = len;
+      blob = NULL;
+    }
+    restore(mask);
+    if (blob != NULL) {
+      freemem(blob, len);
+    }
+  }
+  return tscdf_cols_view(builtin_blob, builtin_len, cols);
+}
+
+#if FS
+/*
+ * the in-memory fs holding converted inputs is made on first use, and
+ * again if something else (fstest) has freed it since
+ */
+static int32
+tscdf_cols_mount(void) {
+  if (!fs_mounted(0)) {
+    if (bs_mkdev(0, MDEV_BLOCK_SIZE, MDEV_NUM_BLOCKS) == SYSERR) {
+      return SYSERR;
+    }
+    if (fs_mkfs(0, DEFAULT_NUM_INODES) == SYSERR) {
+      bs_freedev(0);
+      return SYSERR;
+    }
+  }
+  return OK;
+}
+
+/*
+ * read a whole blob of *len bytes from filename.  A file stored in one
+ * run of blocks is used where it lies (*mapped); any other is copied
+ * into a new buffer.
+ */
+char *
+tscdf_cols_load(char *filename, int32 *len, bool8 *mapped) {
+  struct tscdf_cols_hdr hdr;
+  char *blob;
+  int32 fd;
+
+  *mapped = FALSE;
+  if (tscdf_cols_mount() == SYSERR) {
+    return NULL;
+  }
+  fd = fs_open(filename, O_RDONLY);
+  if (fd == SYSERR) {
+    return NULL;
+  }
+  if (fs_read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+      || hdr.magic != TSCDF_COLS_MAGIC || hdr.nrecs < 0
+      || hdr.nrecs > (0x7fffffff - (int32)sizeof(hdr)) / (3 * (int32)sizeof(int32))) {
+    fs_close(fd);
+    return NULL;
+  }
+  *len = tscdf_cols_size(hdr.nrecs);
+  if (fs_map(fd, 0, *len, (void **)&blob) == *len) {
+    fs_close(fd);
+    *mapped = TRUE;
+    return blob;
+  }
+  blob = getmem(*len);
+  if (blob == (char *)SYSERR) {
+    fs_close(fd);
+    return NULL;
+  }
+  fs_seek(fd, 0);
+  if (fs_read(fd, blob, *len) != *len) {
+    freemem(blob, *len);
+    fs_close(fd);
+    return NULL;
+  }
+  fs_close(fd);
+  return blob;
+}
+
+int32
+tscdf_cols_save(char *filename, const char *blob, int32 len) {
+  int32 fd, wrote;
+
+  if (tscdf_cols_mount() == SYSERR) {
+    return SYSERR;
+  }
+  fd = fs_create(filename, O_CREAT);
+  if (fd == SYSERR) {
+    fd = fs_open(filename, O_RDWR);
+    if (fd == SYSERR) {
+      return SYSERR;
+    }
+  }
+  fs_fallocate(fd, len);  /* in one run if it can, so loads can map it */
+  wrote = fs_write(fd, (void *)blob, len);
+  fs_close(fd);
+  return (wrote == len) ? OK : SYSERR;
+}
+#else
+char *
+tscdf_cols_load(char *filename, int32 *len, bool8 *mapped) {
+  *mapped = FALSE;
+  return NULL;
+}
+
+int32
+tscdf_cols_save(char *filename, const char *blob, int32 len) {
+  return SYSERR;
+}
+#endif
+
+/* give back a blob from tscdf_cols_load */
+void
+tscdf_cols_release(char *blob, int32 len, bool8 mapped) {
+  if (blob != NULL && !mapped) {
+    freemem(blob, len);
+  }
+}
+
+/* run tscdf_conv <file>: store the compiled-in input as a packed file */
+int tscdf_conv(int nargs, char *args[]) {
+  struct tscdf_cols cols;
+
+  if (nargs != 2) {
+    printf("Usage: run tscdf_conv <file>\n");
+    signal(run_command_done);
+    return SYSERR;
+  }
+  if (tscdf_cols_builtin(&cols) == SYSERR) {
+    printf("tscdf_conv: conversion failed\n");
+    signal(run_command_done);
+    return SYSERR;
+  }
+  if (tscdf_cols_save(args[1], builtin_blob, builtin_len) == SYSERR) {
+    printf("tscdf_conv: could not write %d bytes to %s\n", builtin_len, args[1]);
+    signal(run_command_done);
+    return SYSERR;
+  }
+  printf("%s: %d records, %d streams, %d bytes\n", args[1], cols.nrecs, cols.nstreams, builtin_len);
+  signal(run_command_done);
+  return OK;
+}
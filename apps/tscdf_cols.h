@@ -0,0 +1,44 @@
+#include <xinu.h>
+
+/*
+ * Packed input for stream_proc: a header followed by three int32
+ * columns (stream id, timestamp, value) of nrecs entries each.  A
+ * struct tscdf_cols points straight into such a blob, so producers read
+ * records with no parsing or copying.
+ */
+#define TSCDF_COLS_MAGIC 0x31435354  /* "TSC1" read as little endian */
+
+struct tscdf_cols_hdr {
+  uint32 magic;
+  int32 nrecs;
+  int32 nstreams;   /* one more than the largest stream id */
+  int32 reserved;
+};
+
+struct tscdf_cols {
+  int32 nrecs;
+  int32 nstreams;
+  const int32 *stream;
+  const int32 *time;
+  const int32 *value;
+};
+
+#define tscdf_cols_size(n) (sizeof(struct tscdf_cols_hdr) + 3 * (n) * sizeof(int32))
+
+int32
+tscdf_cols_view(const char *blob, int32 len, struct tscdf_cols *cols);
+
+char *
+tscdf_cols_convert(const char *lines[], int32 n, int32 *len);
+
+int32
+tscdf_cols_builtin(struct tscdf_cols *cols);
+
+char *
+tscdf_cols_load(char *filename, int32 *len, bool8 *mapped);
+
+void
+tscdf_cols_release(char *blob, int32 len, bool8 mapped);
+
+int32
+tscdf_cols_save(char *filename, const char *blob, int32 len);
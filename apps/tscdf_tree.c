@@ -0,0 +1,152 @@
+#include "tscdf.h"
+
+/*
+ * Order-statistic treap backend for tscdf windows.  Nodes are the window
+ * elements themselves: vprev/vnext are the left/right children, vsize
+ * counts the subtree, and vprio keeps the tree balanced in expectation,
+ * so insertion, removal and selecting a rank are all O(log window).
+ * Equal values are ordered by their slot in tc->data (tscdf_before) so
+ * that removal can find the exact element being evicted.
+ */
+
+static void tscdf_tree_insert(struct tscdf *tc, struct tscdf_element *te);
+static void tscdf_tree_remove(struct tscdf *tc, struct tscdf_element *te);
+static void tscdf_tree_select(struct tscdf *tc, const int32 *ranks,
+                              struct tscdf_element **out, int32 n);
+static struct tscdf_element *tscdf_tree_succ(struct tscdf *tc,
+                                             struct tscdf_element *te);
+static struct tscdf_element *tscdf_tree_pred(struct tscdf *tc,
+                                             struct tscdf_element *te);
+
+const struct tscdf_backend tscdf_tree_backend = {
+  tscdf_tree_insert, tscdf_tree_remove, tscdf_tree_select,
+  tscdf_tree_succ, tscdf_tree_pred
+};
+
+#define tsize(t) ((t) == NULL ? 0 : (t)->vsize)
+#define tbefore(a, b) tscdf_before(a, b)
+
+/* split t into the elements before key (*l) and the rest (*r) */
+static void
+tscdf_tree_split(struct tscdf_element *t, struct tscdf_element *key,
+                 struct tscdf_element **l, struct tscdf_element **r) {
+  if (t == NULL) {
+    *l = *r = NULL;
+    return;
+  }
+  if (tbefore(t, key)) {
+    tscdf_tree_split(t->vnext, key, &t->vnext, r);
+    *l = t;
+  }
+  else {
+    tscdf_tree_split(t->vprev, key, l, &t->vprev);
+    *r = t;
+  }
+  t->vsize = tsize(t->vprev) + tsize(t->vnext) + 1;
+}
+
+/* join two trees where every element of l sorts before every one of r */
+static struct tscdf_element *
+tscdf_tree_merge(struct tscdf_element *l, struct tscdf_element *r) {
+  if (l == NULL) {
+    return r;
+  }
+  if (r == NULL) {
+    return l;
+  }
+  if (l->vprio > r->vprio) {
+    l->vnext = tscdf_tree_merge(l->vnext, r);
+    l->vsize = tsize(l->vprev) + tsize(l->vnext) + 1;
+    return l;
+  }
+  r->vprev = tscdf_tree_merge(l, r->vprev);
+  r->vsize = tsize(r->vprev) + tsize(r->vnext) + 1;
+  return r;
+}
+
+static void
+tscdf_tree_insert(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_element **link = &tc->vhead;
+
+  /* xorshift32: cheap priorities are all a treap needs */
+  tc->seed ^= tc->seed << 13;
+  tc->seed ^= tc->seed >> 17;
+  tc->seed ^= tc->seed << 5;
+  te->vprio = tc->seed;
+  te->vsize = 1;
+
+  /* descend past nodes of higher priority, then split below te */
+  while (*link != NULL && (*link)->vprio > te->vprio) {
+    (*link)->vsize++;
+    link = tbefore(te, *link) ? &(*link)->vprev : &(*link)->vnext;
+  }
+  tscdf_tree_split(*link, te, &te->vprev, &te->vnext);
+  te->vsize = tsize(te->vprev) + tsize(te->vnext) + 1;
+  *link = te;
+}
+
+static void
+tscdf_tree_remove(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_element **link = &tc->vhead;
+
+  while (*link != te) {
+    (*link)->vsize--;
+    link = tbefore(te, *link) ? &(*link)->vprev : &(*link)->vnext;
+  }
+  *link = tscdf_tree_merge(te->vprev, te->vnext);
+}
+
+static void
+tscdf_tree_select(struct tscdf *tc, const int32 *ranks,
+                  struct tscdf_element **out, int32 n) {
+  struct tscdf_element *t;
+  int32 i, k;
+
+  for (i = 0; i < n; i++) {
+    t = tc->vhead;
+    k = ranks[i];
+    while (k != tsize(t->vprev)) {
+      if (k < tsize(t->vprev)) {
+        t = t->vprev;
+      }
+      else {
+        k -= tsize(t->vprev) + 1;
+        t = t->vnext;
+      }
+    }
+    out[i] = t;
+  }
+}
+
+/* nodes have no parent links, so neighbours are found from the root */
+static struct tscdf_element *
+tscdf_tree_succ(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_element *t = tc->vhead, *best = NULL;
+
+  while (t != NULL) {
+    if (tbefore(te, t)) {
+      best = t;
+      t = t->vprev;
+    }
+    else {
+      t = t->vnext;
+    }
+  }
+  return best;
+}
+
+static struct tscdf_element *
+tscdf_tree_pred(struct tscdf *tc, struct tscdf_element *te) {
+  struct tscdf_element *t = tc->vhead, *best = NULL;
+
+  while (t != NULL) {
+    if (tbefore(t, te)) {
+      best = t;
+      t = t->vnext;
+    }
+    else {
+      t = t->vprev;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,286 @@
+#include <xinu.h>
+#include "tsketch.h"
+
+#define TSKETCH_SLACK 16  /* extra buckets taken each time a store grows */
+
+/* bucket index of a value; negative values mirror the positive ones */
+static int32
+tsketch_index(int32 bits, int32 value) {
+  uint32 u;
+  int32 e, k;
+
+  u = (value < 0) ? (uint32)(-(value + 1)) : (uint32)value;
+  if (u < (1U << bits)) {
+    k = u;
+  }
+  else {
+    e = 31 - __builtin_clz(u);
+    k = (1 << bits) + ((e - bits) << (bits - 1))
+        + ((u >> (e - bits + 1)) & ((1 << (bits - 1)) - 1));
+  }
+  return (value < 0) ? -k - 1 : k;
+}
+
+/* midpoint of the values that fall in a bucket */
+static int32
+tsketch_value(int32 bits, int32 index) {
+  int32 k, j, e;
+  uint32 u;
+
+  k = (index < 0) ? -index - 1 : index;
+  if (k < (1 << bits)) {
+    u = k;
+  }
+  else {
+    j = k - (1 << bits);
+    e = bits + (j >> (bits - 1));
+    u = (((1U << (bits - 1)) + (j & ((1 << (bits - 1)) - 1))) << (e - bits + 1))
+        + ((1U << (e - bits + 1)) >> 1);
+  }
+  return (index < 0) ? -(int32)u - 1 : (int32)u;
+}
+
+/* make sure a store covers index, keeping the counts it already has */
+static int32
+tsketch_grow(struct tsketch_store *st, int32 index) {
+  int32 lo, hi, n;
+  uint32 *counts;
+
+  if (st->n > 0 && index >= st->lo && index < st->lo + st->n) {
+    return OK;
+  }
+  if (st->n == 0) {
+    lo = index - TSKETCH_SLACK / 2;
+    hi = index + TSKETCH_SLACK / 2;
+  }
+  else {
+    lo = st->lo;
+    hi = st->lo + st->n - 1;
+    if (index < lo) {
+      lo = index - TSKETCH_SLACK;
+    }
+    if (index > hi) {
+      hi = index + TSKETCH_SLACK;
+    }
+  }
+  n = hi - lo + 1;
+
+  counts = (uint32 *)getmem(n * sizeof(uint32));
+  if (counts == (uint32 *)SYSERR) {
+    return SYSERR;
+  }
+  memset(counts, 0, n * sizeof(uint32));
+  if (st->n > 0) {
+    memcpy(&counts[st->lo - lo], st->counts, st->n * sizeof(uint32));
+    freemem((char *)st->counts, st->n * sizeof(uint32));
+  }
+  st->lo = lo;
+  st->n = n;
+  st->counts = counts;
+  return OK;
+}
+
+static void
+tsketch_release(struct tsketch_store *st) {
+  if (st->n > 0) {
+    freemem((char *)st->counts, st->n * sizeof(uint32));
+  }
+  st->n = 0;
+}
+
+struct tsketch *
+tsketch_init(int32 maxvals, int32 epsilon_ppm) {
+  struct tsketch *sk;
+  int32 i;
+
+  if (maxvals <= 0 || epsilon_ppm <= 0) {
+    return NULL;
+  }
+  sk = (struct tsketch *)getslab(sizeof(struct tsketch));
+  if (sk == (struct tsketch *)SYSERR) {
+    return NULL;
+  }
+  /* smallest number of bits whose relative error 2^-bits is in bound */
+  sk->bits = 1;
+  while (sk->bits < TSKETCH_MAXBITS && (1000000 >> sk->bits) > epsilon_ppm) {
+    sk->bits++;
+  }
+  sk->blocksize = (maxvals + TSKETCH_NBLOCK - 1) / TSKETCH_NBLOCK;
+  sk->cur = 0;
+  sk->count = sk->seen = 0;
+  sk->total.n = 0;
+  for (i = 0; i < TSKETCH_NBLOCK; i++) {
+    sk->block[i].n = 0;
+    sk->blockcount[i] = 0;
+  }
+  return sk;
+}
+
+void
+tsketch_free(struct tsketch *sk) {
+  int32 i;
+
+  tsketch_release(&sk->total);
+  for (i = 0; i < TSKETCH_NBLOCK; i++) {
+    tsketch_release(&sk->block[i]);
+  }
+  freeslab((char *)sk, sizeof(struct tsketch));
+}
+
+int32
+tsketch_add(struct tsketch *sk, int32 value) {
+  struct tsketch_store *blk, *old;
+  int32 index, i;
+
+  /* the newest block is full: retire the oldest and start over in it */
+  if (sk->blockcount[sk->cur] == sk->blocksize) {
+    sk->cur = (sk->cur + 1) % TSKETCH_NBLOCK;
+    old = &sk->block[sk->cur];
+    for (i = 0; i < old->n; i++) {
+      sk->total.counts[old->lo - sk->total.lo + i] -= old->counts[i];
+      old->counts[i] = 0;
+    }
+    sk->count -= sk->blockcount[sk->cur];
+    sk->blockcount[sk->cur] = 0;
+  }
+
+  index = tsketch_index(sk->bits, value);
+  blk = &sk->block[sk->cur];
+
+  /* the total always spans every block's range */
+  if (tsketch_grow(blk, index) == SYSERR
+      || tsketch_grow(&sk->total, blk->lo) == SYSERR
+      || tsketch_grow(&sk->total, blk->lo + blk->n - 1) == SYSERR) {
+    return SYSERR;
+  }
+  blk->counts[index - blk->lo]++;
+  sk->total.counts[index - sk->total.lo]++;
+  sk->blockcount[sk->cur]++;
+  sk->count++;
+  sk->seen++;
+  return OK;
+}
+
+/*
+ * Copy of the counts sk currently covers, trimmed to the buckets in use,
+ * as a compact summary that can be handed to another process and merged.
+ */
+struct tsketch *
+tsketch_snapshot(struct tsketch *sk) {
+  struct tsketch *snap;
+  int32 lo, hi, i;
+
+  snap = (struct tsketch *)getslab(sizeof(struct tsketch));
+  if (snap == (struct tsketch *)SYSERR) {
+    return NULL;
+  }
+  snap->bits = sk->bits;
+  snap->blocksize = sk->blocksize;
+  snap->cur = 0;
+  snap->count = snap->seen = sk->count;
+  snap->total.n = 0;
+  for (i = 0; i < TSKETCH_NBLOCK; i++) {
+    snap->block[i].n = 0;
+    snap->blockcount[i] = 0;
+  }
+  if (sk->count == 0) {
+    return snap;
+  }
+
+  lo = 0;
+  hi = sk->total.n - 1;
+  while (sk->total.counts[lo] == 0) {
+    lo++;
+  }
+  while (sk->total.counts[hi] == 0) {
+    hi--;
+  }
+  snap->total.counts = (uint32 *)getmem((hi - lo + 1) * sizeof(uint32));
+  if (snap->total.counts == (uint32 *)SYSERR) {
+    freeslab((char *)snap, sizeof(struct tsketch));
+    return NULL;
+  }
+  snap->total.lo = sk->total.lo + lo;
+  snap->total.n = hi - lo + 1;
+  memcpy(snap->total.counts, &sk->total.counts[lo],
+         snap->total.n * sizeof(uint32));
+  return snap;
+}
+
+/* add the counts covered by src to dst; both need the same epsilon */
+int32
+tsketch_merge(struct tsketch *dst, struct tsketch *src) {
+  struct tsketch_store *st = &src->total;
+  int32 i;
+
+  if (dst->bits != src->bits) {
+    return SYSERR;
+  }
+  if (src->count == 0) {
+    return OK;
+  }
+  if (tsketch_grow(&dst->total, st->lo) == SYSERR
+      || tsketch_grow(&dst->total, st->lo + st->n - 1) == SYSERR) {
+    return SYSERR;
+  }
+  for (i = 0; i < st->n; i++) {
+    dst->total.counts[st->lo - dst->total.lo + i] += st->counts[i];
+  }
+  dst->count += src->count;
+  dst->seen += src->count;
+  return OK;
+}
+
+/* quantiles given in ascending order are answered in one pass */
+int32
+tsketch_quantiles(struct tsketch *sk, const int32 *ranks_permille,
+                  int32 *out, int32 n) {
+  uint32 rank, below;
+  int32 i, b;
+
+  if (sk->count == 0) {
+    return SYSERR;
+  }
+  below = 0;
+  b = 0;
+  for (i = 0; i < n; i++) {
+    if (ranks_permille[i] < 0 || ranks_permille[i] > 1000) {
+      return SYSERR;
+    }
+    rank = (uint32)udiv64((uint64)ranks_permille[i] * sk->count, 1000, NULL);
+    if (rank >= sk->count) {
+      rank = sk->count - 1;
+    }
+    if (rank < below) {
+      below = 0;
+      b = 0;
+    }
+    while (below + sk->total.counts[b] <= rank) {
+      below += sk->total.counts[b];
+      b++;
+    }
+    out[i] = tsketch_value(sk->bits, sk->total.lo + b);
+  }
+  return OK;
+}
+
+/* parse a decimal such as "0.01" or ".5" into parts per million */
+int32
+tsketch_parse_epsilon(const char *s) {
+  int32 whole = 0, frac = 0, scale = 100000;
+
+  while (*s >= '0' && *s <= '9') {
+    whole = whole * 10 + (*s++ - '0');
+  }
+  if (*s == '.') {
+    s++;
+    while (*s >= '0' && *s <= '9') {
+      frac += (*s++ - '0') * scale;
+      scale /= 10;
+    }
+  }
+  if (*s != '\0' || whole > 0 || frac <= 0) {
+    return SYSERR;
+  }
+  return frac;
+}
@@ -0,0 +1,61 @@
+/*
+ * Approximate, mergeable quantile sketch for tscdf windows.
+ *
+ * Values are counted in log-linear buckets: values below 2^bits each get
+ * their own bucket, and every power of two above that is split into
+ * 2^(bits-1) equal buckets, so a bucket's midpoint is within 2^-bits of
+ * any value in it.  bits is the smallest that meets the requested
+ * relative error, and memory depends only on the range of buckets used,
+ * never on the window length.
+ *
+ * The window is kept as TSKETCH_NBLOCK blocks of counts.  When the
+ * newest block fills, the oldest is subtracted from the total and
+ * reused, so the sketch covers between (NBLOCK-1)/NBLOCK of the window
+ * and the whole window.
+ *
+ * tsketch_snapshot copies just the covered counts; snapshots taken with
+ * the same epsilon add together with tsketch_merge into a summary that
+ * answers quantiles over all of them.
+ */
+#define TSKETCH_NBLOCK 8
+#define TSKETCH_MAXBITS 16
+
+/* Counts for bucket indices lo .. lo+n-1, grown on demand */
+struct tsketch_store {
+  int32 lo;
+  int32 n;
+  uint32 *counts;
+};
+
+struct tsketch {
+  int32 bits;           /* exact below 2^bits, then 2^(bits-1) per octave */
+  int32 blocksize;      /* samples per block */
+  int32 cur;            /* block receiving new samples */
+  uint32 count;         /* samples currently covered */
+  uint32 seen;          /* samples ever added */
+  struct tsketch_store total;
+  struct tsketch_store block[TSKETCH_NBLOCK];
+  uint32 blockcount[TSKETCH_NBLOCK];
+};
+
+struct tsketch *
+tsketch_init(int32 maxvals, int32 epsilon_ppm);
+
+void
+tsketch_free(struct tsketch *sk);
+
+int32
+tsketch_add(struct tsketch *sk, int32 value);
+
+struct tsketch *
+tsketch_snapshot(struct tsketch *sk);
+
+int32
+tsketch_merge(struct tsketch *dst, struct tsketch *src);
+
+int32
+tsketch_quantiles(struct tsketch *sk, const int32 *ranks_permille,
+                  int32 *out, int32 n);
+
+int32
+tsketch_parse_epsilon(const char *s);
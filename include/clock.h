@@ -2,12 +2,30 @@
 
 extern	uint32	clktime;	/* current time in secs since boot	*/
 
-extern	qid16	sleepq;		/* queue for sleeping processes		*/
-extern	int32	slnonempty;	/* nonzero if sleepq is nonempty	*/
-extern	int32	*sltop;		/* ptr to key in first item on sleepq	*/
 extern	uint32	preempt;	/* preemption counter			*/
 extern volatile ulong clkticks;
 
+/* Tickless idle: while only the null process can run, the clock is	*/
+/*   programmed one-shot for the next timer expiry instead of every	*/
+/*   millisecond, and the ticks that elapsed are accounted for when	*/
+/*   it fires or when another process becomes ready		*/
+
+extern	bool8	clktickless;	/* TRUE if tickless idle is enabled	*/
+extern	bool8	clkidle;	/* TRUE while in a tickless one-shot	*/
+extern	uint32	clkintr;	/* clock interrupts since boot		*/
+
+void	clkresume(void);
+
+/* High-resolution time: getcycles() reads a free-running counter	*/
+/*   whose rate is measured (or known) in clkinit, and gettime_ns()	*/
+/*   converts it as ns = (cycles * clkcycmult) >> CLKCYCSHIFT	*/
+
+#define	CLKCYCSHIFT	22	/* fraction bits of clkcycmult		*/
+
+extern	uint32	clkcyckhz;	/* cycle counter rate in kHz		*/
+extern	uint32	clkcycmult;	/* ns per cycle, scaled by CLKCYCSHIFT	*/
+extern	uint64	clkcycboot;	/* cycle count when clkinit ran		*/
+
 #if defined(X86_GALILEO) || defined(X86_QEMU)
 /* Intel 8254-2 clock chip constants */
 
@@ -18,10 +36,18 @@ extern volatile ulong clkticks;
 
 #define CLKTICKS_PER_SEC  1000  /* clock timer resolution               */
 
+#define CLKCNT_MS       1193    /* PIT counts per ms (1.193 MHz input)  */
+#define CLKMODE_RATE    0x34    /* Counter 0, rate generator (periodic) */
+#define CLKMODE_ONESHOT 0x30    /* Counter 0, interrupt on terminal cnt */
+#define CLKLATCH        0x00    /* Counter 0, latch count for reading   */
+#define CLKMAXIDLE      54      /* Longest one-shot the 16-bit PIT can  */
+                                /*   time (ms)                          */
+
 #endif /* X86_GALILEO */
 
 #ifdef ARM_QEMU
 #define CLKTICKS_PER_SEC  1000
+#define CLKMAXIDLE        1000  /* Longest tickless one-shot (ms)       */
 
 
 
@@ -29,6 +55,7 @@ void clkinit(void);
 void clkupdate(ulong cycles);
 ulong clkcount(void);
 interrupt clkhandler(void);
+void clkstart(void);
 void udelay(ulong);
 void mdelay(ulong);
 
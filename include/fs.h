@@ -23,7 +23,8 @@
 #define FILENAMELEN 16
 #define INODEBLOCKS 12
 #define INODEDIRECTBLOCKS (INODEBLOCKS - 2)
-#define DIRECTORY_SIZE 16
+#define INODE_INDIRECT INODEDIRECTBLOCKS         // blocks[] slot of the single-indirect block
+#define INODE_DINDIRECT (INODEDIRECTBLOCKS + 1)  // blocks[] slot of the double-indirect block
 
 #define MDEV_BLOCK_SIZE 512
 #define MDEV_NUM_BLOCKS 512
@@ -46,24 +47,14 @@ typedef struct inode {
   short int type;           // !< INODE_TYPE_FILE, INODE_TYPE_DIR
   short int nlink;          // !< Number of hard links
   int device;               // !< Device
-  int size;
-  int blocks[INODEBLOCKS];  // !< First INODEBLOCKS which contain file's data
+  int size;                 // !< Bytes; for a directory, dirent slots * sizeof(dirent_t)
+  int blocks[INODEBLOCKS];  // !< Direct data blocks, then the indirect and double-indirect block
 } inode_t;
 
 
-/**
- * Struct to store file details like state, fileptr
- */
-typedef struct filetable {
-  int state;          // !< State: FSTATE_OPEN, FSTATE_CLOSED
-  int fileptr;        // !< file pointer offset
-  struct dirent *de;  // !< Directory entry
-  inode_t in;         // !< Inode structure
-  int flag;           // !< Contains the permission
-} filetable_t;
-
 /**
  * Struct to store directory entry
+ * Directories keep these in their data blocks; a free slot has inode_num EMPTY
  */
 typedef struct dirent {
   int inode_num;           // !< Inode number
@@ -71,12 +62,25 @@ typedef struct dirent {
 } dirent_t;
 
 /**
- * Struct to store directory details
+ * Struct to remember where block lookups for an inode left off
  */
-typedef struct directory {
-  int numentries;                  // !< Number of entries
-  dirent_t entry[DIRECTORY_SIZE];  // !< Subdirectories
-} directory_t;
+typedef struct blockmap {
+  int indblk;         // !< Indirect block of the last lookup, 0 if none
+  int indbase;        // !< First file block that indblk maps
+  int goal;           // !< Disk block to try first for the inode's next new block
+} blockmap_t;
+
+/**
+ * Struct to store file details like state, fileptr
+ */
+typedef struct filetable {
+  int state;          // !< State: FSTATE_OPEN, FSTATE_CLOSED
+  int fileptr;        // !< file pointer offset
+  dirent_t de;        // !< Directory entry the file was opened by
+  inode_t in;         // !< Inode structure
+  int flag;           // !< Contains the permission
+  blockmap_t map;     // !< Block lookups for the inode
+} filetable_t;
 
 /**
  * Struct to file system details
@@ -88,7 +92,8 @@ typedef struct fsystem {
   int inodes_used;       // !< Number of inodes in use
   int freemaskbytes;     // !< Number of bytes for free bitmap
   char *freemask;        // !< Free bitmap
-  directory_t root_dir;  // !< Root directory (entry point into fs)
+  int allochint;         // !< Where the next search for a free block starts
+  int root;              // !< Inode of the root directory (entry point into fs)
 } fsystem_t;
 
 
@@ -96,6 +101,12 @@ typedef struct fsystem {
  * File and directory functions
  */
 
+/**
+ * Files and directories are named by paths from the root directory,
+ * such as "/in/s1.cols" or "in/s1.cols", of components of at most
+ * FILENAMELEN characters.
+ */
+
 /**
  * fs_open
  * Open a file
@@ -161,6 +172,34 @@ int fs_read(int fd, void *buf, int nbytes);
  */
 int fs_write(int fd, void *buf, int nbytes);
 
+/**
+ * fs_fallocate
+ * Allocate blocks for the first @nbytes of file @fd without changing
+ * its size, in one contiguous run if there is one
+ *
+ * @param     fd       file descriptor of file to allocate for
+ * @param     nbytes   number of bytes the file should have room for
+ * @returns   OK on success or else SYSERR
+ */
+int fs_fallocate(int fd, int nbytes);
+
+/**
+ * fs_map
+ * Point @ptr at the data of file @fd from @offset, without copying it.
+ * At most @len bytes are mapped, stopping where the file's blocks stop
+ * being consecutive on the device (fs_fallocate lays them out so) or at
+ * EOF.  The memory is the file itself: it stays valid until the file is
+ * unlinked or the filesystem freed, and may be written through only if
+ * @fd is open for writing.
+ *
+ * @param     fd       file descriptor of file to map
+ * @param     offset   byte offset in the file, at most its size
+ * @param     len      most bytes wanted
+ * @param     ptr      gets the address of byte @offset
+ * @returns   bytes mapped (0 at EOF) or else SYSERR
+ */
+int fs_map(int fd, int offset, int len, void **ptr);
+
 /**
  * fs_link
  * Add a hardlink to a file pointed by @src_filename
@@ -181,6 +220,27 @@ int fs_link(char *src_filename, char *dst_filename);
  */
 int fs_unlink(char *filename);
 
+/**
+ * fs_mkdir
+ * Create an empty directory @dirname
+ *
+ * @param     dirname
+ * @returns   OK on success or else SYSERR
+ */
+int fs_mkdir(char *dirname);
+
+/**
+ * fs_readdir
+ * Read the next entry of directory @dirname into @de
+ * Set @*pos to 0 for the first entry; each call moves it past the entry read
+ *
+ * @param     dirname
+ * @param     pos      position in the directory
+ * @param     de       destination directory entry
+ * @returns   OK, EOF after the last entry, or else SYSERR
+ */
+int fs_readdir(char *dirname, int *pos, dirent_t *de);
+
 
 /**
  * Filesystem functions
@@ -207,6 +267,16 @@ int fs_mkfs(int dev, int num_inodes);
  */
 int fs_freefs(int dev);
 
+/**
+ * fs_mounted
+ * Whether device @dev holds a file system made by fs_mkfs that has not
+ * been removed by fs_freefs (or had its device freed) since
+ *
+ * @param     dev
+ * @returns   TRUE or FALSE
+ */
+bool8 fs_mounted(int dev);
+
 
 /**
  * Filesystem internal functions
@@ -215,6 +285,7 @@ int fs_freefs(int dev);
 /**
  * _fs_get_inode_by_num
  * Read in an inode by @inode_number and fill in the pointer @out
+ * Inodes are cached in memory, so this never touches the device
  *
  * @param     dev
  * @param     inode_number
@@ -226,6 +297,8 @@ int _fs_get_inode_by_num(int dev, int inode_number, inode_t *out);
 /**
  * _fs_put_inode_by_num
  * Write an inode by @inode_number by pointer @in
+ * Only the cache is updated; the inode block is written back with the
+ * rest of its block on fs_close or fs_freefs
  *
  * @param     dev
  * @param     inode_number
@@ -312,9 +385,30 @@ int bs_bread(int bsdev, int block, int offset, void *buf, int len);
  */
 int bs_bwrite(int bsdev, int block, int offset, void *buf, int len);
 
+/**
+ * bs_baddr
+ * Address of @block of @bsdev in memory.  Blocks are laid out in order,
+ * so a run of consecutive blocks is one run of memory.
+ *
+ * @param     bsdev
+ * @param     block
+ * @returns   pointer to the start of the block, or NULL if it is bad
+ */
+char *bs_baddr(int bsdev, int block);
+
 /**
  * Helper functions
  */
+
+/**
+ * _fs_fileblock_to_diskblock
+ * Look up the disk block holding block @fileblock of the file open as @fd
+ *
+ * @param     dev
+ * @param     fd
+ * @param     fileblock
+ * @returns   disk block, 0 if not allocated, or SYSERR if out of range
+ */
 int _fs_fileblock_to_diskblock(int dev, int fd, int fileblock);
 
 /**
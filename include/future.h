@@ -7,8 +7,9 @@
  *******************************************************/
 #include <xinu.h>
 
-// Quick macro to check if a future's data queue is full (with a pointer 'f')
-#define data_queue_full(f) (f->count >= f->max_elems)
+// Quick macro to check if a future's data queue is full (with a pointer 'f').
+// Slots handed out by future_reserve count as used until they are committed.
+#define data_queue_full(f) (f->count + f->reserved >= f->max_elems)
 
 typedef enum {
 	FUTURE_EMPTY,
@@ -34,13 +35,29 @@ typedef struct future_t {
 	uint16 count;
 	uint16 head;
 	uint16 tail;
+	uint16 reserved; // Slots handed out by future_reserve, not yet committed
+	uint16 peeked;   // Slots handed out by future_peek, not yet released
 } future_t;
 
 future_t* future_alloc(future_mode_t mode, uint size, uint nelems);
 syscall future_free(future_t* f);
 
 syscall future_get(future_t* f, char* out);
+syscall future_get_timeout(future_t* f, char* out, int32 maxwait);
 syscall future_set(future_t* f, char* in);
 
+// Batched FUTURE_QUEUE transfers: move up to n elements per call and
+// return how many were moved.
+int32 future_set_n(future_t* f, char* in, uint32 n);
+int32 future_get_n(future_t* f, char* out, uint32 n);
+
+// Zero-copy access to FUTURE_QUEUE slots. A side of the queue uses either
+// these or future_get/future_set, not both at once.
+char* future_reserve(future_t* f);
+syscall future_commit(future_t* f);
+char* future_peek(future_t* f);
+syscall future_release(future_t* f);
+
 int future_fib(int nargs, char *args[]);
 int future_free_test(int nargs, char *args[]);
+int future_timeout_test(int nargs, char *args[]);
@@ -53,12 +53,26 @@ struct procent {		/* Entry in the process table		*/
 	pid32	prparent;	/* ID of the creating process		*/
 	umsg32	prmsg;		/* Message sent to this process		*/
 	bool8	prhasmsg;	/* Nonzero iff msg is valid		*/
+	bool8	prtimeout;	/* Nonzero iff a timed wait expired	*/
+	qid16	prwaitq;	/* Queue of a timed PR_FWAIT, or EMPTY	*/
 	int16	prdesc[NDESC];	/* Device descriptors for process	*/
+	uint32	prvolsw;	/* Switches away while blocking		*/
+	uint32	prinvolsw;	/* Switches away while still ready	*/
+	uint64	prcycles;	/* CPU cycles consumed			*/
+	uint64	prwaitcyc;	/* Cycles spent in PR_WAIT		*/
+	uint64	prfwaitcyc;	/* Cycles spent in PR_FWAIT		*/
+	uint64	prsleepcyc;	/* Cycles spent in PR_SLEEP/PR_RECTIM	*/
+	uint64	prblkstart;	/* Cycle count when process blocked	*/
 };
 
 /* Marker for the top of a process stack (used to help detect overflow)	*/
 #define	STACKMAGIC	0x0A0AAAA9
+
+/* Pattern written over an unused stack to find its high-water mark	*/
+#define	STACKFILL	0x5AFE5AFE
 extern uint32 __attribute__((aligned(16384))) page_table[NPROC][NUM_PAGE_TABLE_ENTRIES];
 extern	struct	procent proctab[];
 extern	int32	prcount;	/* Currently active processes		*/
 extern	pid32	currpid;	/* Currently executing process		*/
+extern	uint64	currstart;	/* Cycle count when currpid started	*/
+extern	uint32	nctxsw;		/* Context switches since boot		*/
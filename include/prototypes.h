@@ -109,12 +109,18 @@ extern	syscall	freebuf(char *);
 /* in file freemem.c */
 extern	syscall	freemem(char *, uint32);
 
+/* in file freeslab.c */
+extern	syscall	freeslab(char *, uint32);
+
 /* in file getbuf.c */
 extern	char	*getbuf(bpid32);
 
 /* in file getc.c */
 extern	syscall	getc(did32);
 
+/* in file getcycles.c */
+extern	uint64	getcycles(void);
+
 /* in file getitem.c */
 extern	pid32	getfirst(qid16);
 extern	pid32	getlast(qid16);
@@ -125,6 +131,15 @@ pid32 getitem(pid32);
 /* in file getmem.c */
 extern	char	*getmem(uint32);
 
+/* in file getslab.c */
+extern	char	*getslab(uint32);
+
+/* in file gettime_ns.c */
+extern	void	cycinit(uint32);
+extern	uint64	cycles2ns(uint64);
+extern	uint64	gettime_ns(void);
+extern	uint64	udiv64(uint64, uint32, uint32 *);
+
 /* in file getpid.c */
 extern	pid32	getpid(void);
 
@@ -442,6 +457,12 @@ extern	umsg32	recvtime(int32);
 extern	void	resched(void);
 extern	status	resched_cntl(int32);
 
+/* in file rqueue.c */
+extern	void	rqinit(void);
+extern	status	rqinsert(pid32, int32);
+extern	pid32	rqremove(pid32);
+extern	pid32	rqdequeue(void);
+
 /* in file intutils.S */
 extern	void	restore(intmask);
 
@@ -541,6 +562,10 @@ extern	syscall	signal(sid32);
 /* in file signaln.c */
 extern	syscall	signaln(sid32, int32);
 
+/* in file slabinit.c */
+extern	status	slabinit(void);
+extern	int32	slabindex(uint32);
+
 /* in file sleep.c */
 extern	syscall	sleepms(uint32);
 extern	syscall	sleep(uint32);
@@ -555,6 +580,9 @@ extern	int32	outl(int32, int32);
 extern	int32	outsw(int32, int32, int32);
 extern	int32	insw(int32, int32 ,int32);
 
+/* in file stkhwm.c */
+extern	int32	stkhwm(pid32);
+
 /* in file suspend.c */
 extern	syscall	suspend(pid32);
 
@@ -599,6 +627,22 @@ extern	void	udp_ntoh(struct netpacket *);
 extern	void	udp_hton(struct netpacket *);
 
 
+/* in file timer.c */
+extern	void	timerinit(void);
+extern	void	tmenqueue(int32, uint32);
+extern	status	tmdequeue(int32);
+extern	void	tmcascade(int32, int32);
+extern	uint32	tmnextdelay(uint32);
+
+/* in file timer_add.c */
+extern	int32	timer_add(void (*)(void *), void *, uint32);
+extern	syscall	timer_cancel(int32);
+
+/* in file trace.c */
+extern	void	trevent(uint16, uint32, uint32);
+extern	void	trstart(void);
+extern	void	trstop(void);
+
 /* in file unsleep.c */
 extern	syscall	unsleep(pid32);
 
@@ -608,6 +652,12 @@ extern	void	userret(void);
 /* in file wait.c */
 extern	syscall	wait(sid32);
 
+/* in file waitn.c */
+extern	syscall	waitn(sid32, int32);
+
+/* in file waittime.c */
+extern	syscall	waittime(sid32, int32);
+
 /* in file wakeup.c */
 extern	void	wakeup(void);
 
@@ -670,6 +720,13 @@ extern	void	ttyhandler(uint32);
 
 extern	void	clkdisp(void);
 
+/* in file clkhandler.c */
+extern	void	clkperiodic(void);
+extern	void	clkoneshot(uint32, uint32);
+
+/* in file getcycles.c */
+extern	uint32	cyccalibrate(void);
+
 /* in file ethdispatch.S */
 extern	void	ethdispatch(void);
 
@@ -34,3 +34,15 @@ extern	struct qentry	queuetab[];
 /* Inline to check queue id assumes interrupts are disabled */
 
 #define	isbadqid(x)	(((int32)(x) < 0) || (int32)(x) >= NQENT-1)
+
+/* Ready list index: one bucket per priority, a bitmap of nonempty	*/
+/*   buckets, and the last process of each bucket so that a process	*/
+/*   can be placed in the sorted ready list without walking it.	*/
+/*   Priorities at or below 0 and at or above NRQPRIO-1 share the	*/
+/*   end buckets, which are kept sorted by a short walk.		*/
+
+#define	NRQPRIO		256		/* Number of priority buckets	*/
+#define	NRQWORDS	(NRQPRIO / 32)	/* Words in the bucket bitmap	*/
+
+#define	rqbucket(k)	((k) <= 0 ? 0 : ((k) >= NRQPRIO-1 ? NRQPRIO-1 : (k)))
+#define	rqshared(b)	((b) == 0 || (b) == NRQPRIO-1)
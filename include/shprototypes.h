@@ -13,6 +13,9 @@ extern	shellcmd  xsh_cat	(int32, char *[]);
 /* in file xsh_clear.c */
 extern	shellcmd  xsh_clear	(int32, char *[]);
 
+/* in file xsh_clkstat.c */
+extern	shellcmd  xsh_clkstat	(int32, char *[]);
+
 /* in file xsh_date.c */
 extern	shellcmd  xsh_date	(int32, char *[]);
 
@@ -58,6 +61,12 @@ extern	shellcmd  xsh_ps	(int32, char *[]);
 /* in file xsh_sleep.c */
 extern	shellcmd  xsh_sleep	(int32, char *[]);
 
+/* in file xsh_top.c */
+extern	shellcmd  xsh_top	(int32, char *[]);
+
+/* in file xsh_trace.c */
+extern	shellcmd  xsh_trace	(int32, char *[]);
+
 /* in file xsh_udpdump.c */
 extern	shellcmd  xsh_udpdump	(int32, char *[]);
 
@@ -0,0 +1,44 @@
+/* slab.h - slabclass, slabpage */
+
+/* Size-class (slab) allocator layered on top of getmem/freemem.	*/
+/*   Small requests are served from per-class free lists carved out	*/
+/*   of aligned pages taken from the free memory list, so that both	*/
+/*   allocation and release are constant time.			*/
+
+#define	NSLABCLS	9		/* Number of size classes	*/
+#define	SLAB_MINSIZE	8		/* Smallest class (bytes)	*/
+#define	SLAB_MAXSIZE	2048		/* Largest class (bytes)	*/
+#define	SLAB_MINPAGE	PAGE_SIZE	/* Smallest slab page (bytes)	*/
+#define	SLAB_PERPAGE	8		/* Minimum objects per page	*/
+
+struct	slabobj	{			/* Free object in a slab page	*/
+	struct	slabobj	*sonext;	/* Next free object in page	*/
+};
+
+struct	slabpage {			/* Header at start of each page	*/
+	struct	slabpage *spnext;	/* Next page with free objects	*/
+	struct	slabpage *spprev;	/* Previous page on that list	*/
+	struct	slabobj	*spfree;	/* Free objects in this page	*/
+	uint16	spinuse;		/* Objects currently allocated	*/
+	uint16	spclass;		/* Index of owning size class	*/
+};
+
+struct	slabclass {			/* Entry in the size class table*/
+	uint32	scsize;			/* Object size in bytes		*/
+	uint32	scpagesz;		/* Size of a slab page in bytes	*/
+	uint32	scperpage;		/* Objects that fit in a page	*/
+	struct	slabpage *scpages;	/* Pages that have free objects	*/
+	uint32	scnpages;		/* Pages owned by this class	*/
+	uint32	scempty;		/* Owned pages with no objects	*/
+	uint32	scinuse;		/* Objects currently allocated	*/
+	uint32	scallocs;		/* Total successful allocations	*/
+	uint32	schits;			/* Allocations needing no page	*/
+	uint32	scfrees;		/* Total objects released	*/
+};
+
+extern	struct	slabclass slabtab[];	/* Size class table		*/
+
+/* Bytes held by slab pages that are not occupied by live objects	*/
+
+#define	slabavail(sc)	((sc)->scnpages * (sc)->scpagesz	\
+				- (sc)->scinuse * (sc)->scsize)
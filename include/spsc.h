@@ -0,0 +1,26 @@
+/* spsc.h - single-producer/single-consumer ring */
+
+#include <xinu.h>
+
+/*
+ * A ring shared by exactly one producer and one consumer.  Each index
+ * has a single writer, so neither side takes a lock: the producer only
+ * moves head and the consumer only moves tail.  A side blocks only when
+ * the ring is full or empty, by parking on the other side's index until
+ * it moves.  One slot is always left empty so that head == tail means
+ * the ring is empty.
+ */
+struct	spsc	{
+	volatile uint32	head;		/* Next slot the producer fills	*/
+	volatile uint32	tail;		/* Next slot the consumer reads	*/
+	uint32	size;			/* Bytes in one element		*/
+	uint32	nslots;			/* Elements held, plus one	*/
+	volatile pid32	waiter;		/* Process parked on the ring,	*/
+					/*   or EMPTY			*/
+	char	*data;			/* nslots elements of size	*/
+};
+
+struct	spsc	*spsc_alloc(uint32, uint32);
+syscall	spsc_free(struct spsc *);
+syscall	spsc_put(struct spsc *, char *);
+syscall	spsc_get(struct spsc *, char *);
@@ -1,13 +1,30 @@
 #include <xinu.h>
+#include <spsc.h>
 
 int stream_proc(int nargs, char* args[]);
 int stream_proc_futures(int nargs, char* args[]);
+int tscdf_conv(int nargs, char* args[]);
+int bench(int nargs, char* args[]);
 
 typedef struct data_element {
   int32 time;
   int32 value;
+  uint32 stamp; // Low bits of the cycle count when produced (bench only)
 } de;
 
+// While `run bench stream` drives a pipeline, stream_bench is set: the
+// pipeline prints nothing, producers stamp each record and consumers
+// hand the stamp to stream_bench_record.
+struct stream_stats {
+  uint32 records;           // Records consumed
+  struct tsketch *latency;  // Produce-to-consume cycles
+};
+extern struct stream_stats *stream_bench;
+void stream_bench_record(uint32 stamp);
+
+#define stream_stamp() ((stream_bench != NULL) ? (uint32) getcycles() : 0)
+#define stream_log(...) do { if (stream_bench == NULL) kprintf(__VA_ARGS__); } while (0)
+
 struct stream {
   sid32 spaces;
   sid32 items;
@@ -15,4 +32,5 @@ struct stream {
   int32 head;
   int32 tail;
   struct data_element *queue;
+  struct spsc *ring; // -l mode: replaces the semaphores and queue
 };
@@ -0,0 +1,41 @@
+/* timer.h - tmslot, isbadtid, tmempty */
+
+/* Hierarchical timing wheel used for sleeping processes, timed	*/
+/*   receives, and kernel callouts.  Level 0 has one slot per	*/
+/*   millisecond; each higher level has slots that span a whole	*/
+/*   rotation of the level below and are cascaded down as the	*/
+/*   lower level wraps.  Insertion and cancellation are O(1).	*/
+
+#ifndef	NCALLOUT
+#define	NCALLOUT	32		/* Number of kernel callouts	*/
+#endif
+
+#define	TMBITS0		8		/* Bits of expiry in level 0	*/
+#define	TMBITSN		6		/* Bits of expiry per level > 0	*/
+#define	NTMLEVEL	4		/* Levels in the wheel		*/
+#define	TMSLOTS0	(1 << TMBITS0)	/* Slots in level 0		*/
+#define	TMSLOTSN	(1 << TMBITSN)	/* Slots in each higher level	*/
+#define	NTMSLOT		(TMSLOTS0 + (NTMLEVEL-1) * TMSLOTSN)
+#define	TMMAXDELTA	(1 << (TMBITS0 + (NTMLEVEL-1) * TMBITSN))
+
+/* Entries 0 to NPROC-1 belong to processes, the next NCALLOUT are	*/
+/*   callouts, and the rest are the list heads of the wheel slots	*/
+
+#define	NTIMER		(NPROC + NCALLOUT)
+#define	NTMENT		(NTIMER + NTMSLOT)
+
+struct	tmentry	{			/* Timer or head of a slot list	*/
+	uint32	tmexpire;		/* Time (in ms.) of expiry	*/
+	int16	tmnext;			/* Next entry in the slot	*/
+	int16	tmprev;			/* Previous entry in the slot	*/
+	void	(*tmfunc)(void *);	/* Callout function or NULL	*/
+	void	*tmarg;			/* Argument passed to tmfunc	*/
+};
+
+extern	struct	tmentry	tmtab[];
+extern	uint32	tmnow;			/* Milliseconds processed	*/
+extern	int32	tmcount;		/* Timers currently scheduled	*/
+
+#define	tmslot(s)	(NTIMER + (s))	/* Index of head of slot s	*/
+#define	tmempty(h)	(tmtab[(h)].tmnext == (h))
+#define	isbadtid(t)	(((int32)(t) < NPROC) || ((int32)(t) >= NTIMER))
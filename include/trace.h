@@ -0,0 +1,42 @@
+/* trace.h - trace */
+
+/* Kernel event trace: a ring of fixed-size records, each stamped with	*/
+/*   the cycle counter.  Compile with -DTRACE (make TRACE=1) to	*/
+/*   include the hooks; without it every trace() call compiles to	*/
+/*   nothing.								*/
+
+#ifndef	NTRACE
+#define	NTRACE		2048		/* Records in the ring (power	*/
+#endif					/*   of two)			*/
+
+/* Event types */
+
+#define	TR_CTXSW	1		/* a = old pid, b = new pid	*/
+#define	TR_WAIT		2		/* a = semaphore, b = count	*/
+#define	TR_SIGNAL	3		/* a = semaphore, b = count	*/
+#define	TR_FGET		4		/* a = future, b = mode		*/
+#define	TR_FSET		5		/* a = future, b = mode		*/
+#define	TR_GETMEM	6		/* a = bytes, b = address	*/
+#define	TR_FREEMEM	7		/* a = bytes, b = address	*/
+#define	TR_INTR		8		/* a = IRQ, interrupt entry	*/
+#define	TR_INTREND	9		/* a = IRQ, interrupt exit	*/
+#define	NTREVENT	10		/* One more than largest type	*/
+
+struct	trrec	{			/* One trace record		*/
+	uint64	trcycles;		/* getcycles() at the event	*/
+	uint16	trevent;		/* Event type (TR_xxx)		*/
+	uint16	trpid;			/* Current process		*/
+	uint32	tra;			/* First event argument		*/
+	uint32	trb;			/* Second event argument	*/
+};
+
+extern	struct	trrec	trtab[];	/* The ring of records		*/
+extern	uint32	trnext;			/* Total records written	*/
+extern	bool8	trenabled;		/* TRUE while tracing		*/
+
+#ifdef	TRACE
+#define	trace(ev, a, b)	do { if (trenabled) {				\
+				trevent((ev), (uint32)(a), (uint32)(b)); } } while (0)
+#else
+#define	trace(ev, a, b)	do { } while (0)
+#endif
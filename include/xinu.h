@@ -10,8 +10,11 @@
 #include <resched.h>
 #include <semaphore.h>
 #include <memory.h>
+#include <slab.h>
 #include <bufpool.h>
 #include <clock.h>
+#include <timer.h>
+#include <trace.h>
 #include <mark.h>
 #include <ports.h>
 #include <uart.h>
@@ -88,3 +91,4 @@ extern struct platform platform;
 #endif
 
 int fstest(int nargs, char *args[]);
+int ctxbench(int nargs, char *args[]);
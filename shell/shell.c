@@ -11,6 +11,7 @@ const	struct	cmdent	cmdtab[] = {
 	{"argecho",	TRUE,	xsh_argecho},
 	{"cat",		FALSE,	xsh_cat},
 	{"clear",	TRUE,	xsh_clear},
+	{"clkstat",	FALSE,	xsh_clkstat},
 	{"date",	FALSE,	xsh_date},
 	{"devdump",	FALSE,	xsh_devdump},
 	{"echo",	FALSE,	xsh_echo},
@@ -25,6 +26,10 @@ const	struct	cmdent	cmdtab[] = {
 	{"hello",       FALSE,  xsh_hello},
 	{"prodcons",    FALSE,  xsh_prodcons},
 	{"run",         FALSE,  xsh_run},
+	{"top",		FALSE,	xsh_top},
+#ifdef TRACE
+	{"trace",	FALSE,	xsh_trace},
+#endif
 #ifdef GPIO
 	{"led",         FALSE,  xsh_led},
 #endif
@@ -0,0 +1,117 @@
+/* xsh_clkstat.c - xsh_clkstat */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static	void	clkspin(void);
+static	void	clksample(char *, uint32);
+
+/*------------------------------------------------------------------------
+ * xsh_clkstat - Report the clock interrupt rate while the system is idle
+ *		   and while a process keeps the CPU busy, and turn
+ *		   tickless idle on or off
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_clkstat(int nargs, char *args[])
+{
+	int32	i;			/* Index into args		*/
+	uint32	secs = 1;		/* Length of each sample	*/
+	pid32	spinner;		/* Process that creates load	*/
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	/* For argument '--help', emit help about the 'clkstat' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [-s secs] [-t on|off]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tMeasures the clock interrupt rate at idle and\n");
+		printf("\tunder load\n");
+		printf("Options:\n");
+		printf("\t-s secs\t length of each sample (default 1)\n");
+		printf("\t-t on|off\t enable or disable tickless idle\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	for (i = 1; i < nargs; i++) {
+		if ((strncmp(args[i], "-s", 3) == 0) && (i + 1 < nargs)) {
+			secs = atoi(args[++i]);
+		} else if ((strncmp(args[i], "-t", 3) == 0) && (i + 1 < nargs)) {
+			i++;
+			mask = disable();
+			if (strncmp(args[i], "on", 3) == 0) {
+				clktickless = TRUE;
+			} else if (strncmp(args[i], "off", 4) == 0) {
+				clktickless = FALSE;
+				clkresume();
+			} else {
+				restore(mask);
+				fprintf(stderr, "%s: -t takes on or off\n",
+					args[0]);
+				return 1;
+			}
+			restore(mask);
+		} else {
+			fprintf(stderr, "%s: invalid argument\n", args[0]);
+			fprintf(stderr, "Try '%s --help' for more information\n",
+					args[0]);
+			return 1;
+		}
+	}
+	if (secs == 0) {
+		secs = 1;
+	}
+
+	printf("Tickless idle is %s\n", clktickless ? "on" : "off");
+	clksample("idle", secs);
+
+	/* A low priority process that never blocks keeps the CPU busy	*/
+	/*   while the shell sleeps					*/
+
+	spinner = create((void *)clkspin, 1024, 1, "clkspin", 0);
+	if (spinner == SYSERR) {
+		fprintf(stderr, "%s: cannot create load process\n", args[0]);
+		return 1;
+	}
+	resume(spinner);
+	clksample("load", secs);
+	kill(spinner);
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ * clksample - Sleep for secs seconds and print the interrupt rate
+ *------------------------------------------------------------------------
+ */
+static	void	clksample(
+	  char		*label,		/* Name of the sample		*/
+	  uint32	secs		/* Length of the sample		*/
+	)
+{
+	uint32	intr0, ms0;		/* Counts at start of sample	*/
+	uint32	intr, ms;		/* Differences over the sample	*/
+
+	intr0 = clkintr;
+	ms0 = (clktime * 1000) + clkticks;
+	sleep(secs);
+	intr = clkintr - intr0;
+	ms = ((clktime * 1000) + clkticks) - ms0;
+	if (ms == 0) {
+		ms = 1;
+	}
+	printf("%-6s %8d interrupts in %6d ms  (%d per second)\n",
+		label, intr, ms, (intr * 1000) / ms);
+}
+
+/*------------------------------------------------------------------------
+ * clkspin - Spin forever to keep the CPU busy
+ *------------------------------------------------------------------------
+ */
+static	void	clkspin(void)
+{
+	while (TRUE) {
+		;
+	}
+}
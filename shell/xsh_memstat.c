@@ -6,6 +6,7 @@
 
 static	void	printMemUse(void);
 static	void	printFreeList(void);
+static	void	printSlabStats(void);
 
 /*------------------------------------------------------------------------
  * xsh_memstat - Print statistics about memory use and dump the free list
@@ -19,8 +20,8 @@ shellcmd xsh_memstat(int nargs, char *args[])
 	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
 		printf("use: %s \n\n", args[0]);
 		printf("Description:\n");
-		printf("\tDisplays the current memory use and prints the\n");
-		printf("\tfree list.\n");
+		printf("\tDisplays the current memory use, prints the\n");
+		printf("\tfree list, and reports slab size class use.\n");
 		printf("Options:\n");
 		printf("\t--help\t\tdisplay this help and exit\n");
 		return 0;
@@ -37,6 +38,7 @@ shellcmd xsh_memstat(int nargs, char *args[])
 
 	printMemUse();
 	printFreeList();
+	printSlabStats();
 
 	return 0;
 }
@@ -64,6 +66,37 @@ static void printFreeList(void)
 	printf("\n");
 }
 
+/*------------------------------------------------------------------------
+ * printSlabStats - Print the occupancy and hit rate of each slab size
+ *			class
+ *------------------------------------------------------------------------
+ */
+static void printSlabStats(void)
+{
+	int32	i;			/* Index into slabtab		*/
+	struct	slabclass *scptr;	/* Pointer to entry in slabtab	*/
+	uint32	nfree;			/* Free objects in a class	*/
+	uint32	hitpct;			/* Percent of allocations that	*/
+					/*   did not need a new page	*/
+
+	printf("Slab Classes:\n");
+	printf(" Size  Pages  In use    Free     Allocs     Frees  Hit %%\n");
+	printf("-----  -----  ------  ------  ---------  --------  -----\n");
+
+	for (i = 0; i < NSLABCLS; i++) {
+		scptr = &slabtab[i];
+		nfree = scptr->scnpages * scptr->scperpage - scptr->scinuse;
+		hitpct = 0;
+		if (scptr->scallocs > 0) {
+			hitpct = (scptr->schits * 100) / scptr->scallocs;
+		}
+		printf("%5d  %5d  %6d  %6d  %9d  %8d  %4d%%\n",
+			scptr->scsize, scptr->scnpages, scptr->scinuse,
+			nfree, scptr->scallocs, scptr->scfrees, hitpct);
+	}
+	printf("\n");
+}
+
 extern void start(void);
 extern void *_end;
 
@@ -78,6 +111,7 @@ static void printMemUse(void)
 	uint32 stack = 0;		/* Total used stack memory	*/
 	uint32 kheap = 0;		/* Free kernel heap memory	*/
 	uint32 kfree = 0;		/* Total free memory		*/
+	uint32 slab = 0;		/* Free space in slab pages	*/
 	struct memblk *block;	 	/* Ptr to memory block		*/
 
 	/* Calculate amount of text memory */
@@ -99,6 +133,12 @@ static void printMemUse(void)
 		kfree += block->mlength;
 	}
 
+	/* Calculate the space in slab pages not used by objects */
+
+	for (i = 0; i < NSLABCLS; i++) {
+		slab += slabavail(&slabtab[i]);
+	}
+
 	/* Calculate the amount of free kernel heap memory */
 
 	kheap = kfree - stack;
@@ -109,5 +149,6 @@ static void printMemUse(void)
 	printf("---------------------------------\n");
 	printf("%10d bytes (0x%08x) of Xinu code\n", code, code);
 	printf("%10d bytes (0x%08x) of allocated stack space\n", stack, stack);
-	printf("%10d bytes (0x%08x) of available kernel heap space\n\n", kheap, kheap);
+	printf("%10d bytes (0x%08x) of available kernel heap space\n", kheap, kheap);
+	printf("%10d bytes (0x%08x) of free space in slab pages\n\n", slab, slab);
 }
@@ -14,7 +14,7 @@ shellcmd xsh_ps(int nargs, char *args[])
 	int32	i;			/* index into proctabl		*/
 	char *pstate[]	= {		/* names for process states	*/
 		"free ", "curr ", "ready", "recv ", "sleep", "susp ",
-		"wait ", "rtime"};
+		"wait ", "rtime", "fwait"};
 
 	/* For argument '--help', emit help about the 'ps' command	*/
 
@@ -46,13 +46,22 @@ shellcmd xsh_run(int nargs, char *args[]) {
 		future_prodcons(nargs, args);
 	}
 	else if (strncmp(args[0], "tscdf", 5) == 0) {
-		if (strncmp(args[0], "tscdf_fq", 8) == 0) {
+		if (strncmp(args[0], "tscdf_conv", 10) == 0) {
+			resume(create((void *) tscdf_conv, 4096, 20, "tscdf_conv", 2, nargs, args));
+		}
+		else if (strncmp(args[0], "tscdf_fq", 8) == 0) {
 			resume(create((void *) stream_proc_futures, 4096, 20, "stream_proc_futures", 2, nargs, args));
 		}
 		else {
 			resume(create((void *) stream_proc, 4096, 20, "stream_proc", 2, nargs, args));
 		}
 	}
+	else if (strncmp(args[0], "bench", 6) == 0) {
+		resume(create((void *) bench, 8192, 20, "bench", 2, nargs, args));
+	}
+	else if (strncmp(args[0], "ctxbench", 8) == 0) {
+		resume(create((void *) ctxbench, 8192, 20, "ctxbench", 2, nargs, args));
+	}
 	else if (strncmp(args[0], "fstest", 6) == 0) {
 		fstest(nargs, args);
 		signal(run_command_done);
@@ -68,6 +77,8 @@ shellcmd xsh_run(int nargs, char *args[]) {
 }
 
 void print_list() {
+	printf("bench\n");
+	printf("ctxbench\n");
 	printf("fstest\n");
 	printf("futest\n");
 	printf("hello\n");
@@ -75,6 +86,7 @@ void print_list() {
 	printf("prodcons\n");
 	printf("prodcons_bb\n");
 	printf("tscdf\n");
+	printf("tscdf_conv\n");
 	printf("tscdf_fq\n");
 }
 
@@ -140,7 +152,7 @@ void prodcons_bb(int nargs, char *args[]) {
 
 void future_prodcons(int nargs, char *args[]) {
   print_sem = semcreate(1);
-	const char* USAGE_STR = "Syntax: run futest [-pc [g ...] [s VALUE ...]] | [-pcq LENGTH [g ...] [s VALUE ...]] | [-f NUMBER] | [--free]";
+	const char* USAGE_STR = "Syntax: run futest [-pc [g ...] [s VALUE ...]] | [-pcq LENGTH [g ...] [s VALUE ...]] | [-f NUMBER] | [--free] | [--timeout]";
   if (nargs < 2) {
   	printf("%s\n", USAGE_STR);
 		signal(run_command_done);
@@ -155,6 +167,15 @@ void future_prodcons(int nargs, char *args[]) {
 		}
   	future_free_test(nargs, args);
   }
+  else if (strncmp(args[1], "--timeout", 9) == 0) {
+		if (nargs > 2) {
+			// Extra args
+			printf("%s\n", USAGE_STR);
+			signal(run_command_done);
+			return;
+		}
+  	future_timeout_test(nargs, args);
+  }
   else if (strncmp(args[1], "-f", 2) == 0) {
 		future_fib(nargs, args);
   }
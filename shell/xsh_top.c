@@ -0,0 +1,167 @@
+/* xsh_top.c - xsh_top */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static	uint64	topcyc[NPROC];		/* prcycles at last refresh	*/
+static	uint64	topnow[NPROC];		/* prcycles for this refresh	*/
+static	uint64	topstamp;		/* Cycle count at last refresh	*/
+
+static	uint64	topsnap(uint64 *);
+static	uint32	cyc2ms(uint64);
+static	uint32	topshare(uint64, uint64);
+
+/*------------------------------------------------------------------------
+ * xsh_top - Periodically display CPU use, context switches, blocked
+ *	       time, and stack use for every process
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_top(int nargs, char *args[])
+{
+	struct	procent	*prptr;		/* Pointer to process		*/
+	int32	i;			/* Index into args / proctab	*/
+	int32	delay = 1000;		/* Milliseconds between updates	*/
+	int32	count = 10;		/* Updates to show (0 = forever)*/
+	int32	iter;			/* Updates shown so far		*/
+	int32	stk;			/* Stack high-water mark	*/
+	uint64	stamp, total, used;	/* Cycle counts			*/
+	uint32	permil;			/* CPU use in tenths of percent	*/
+	char	*pstate[] = {		/* Names for process states	*/
+		"free ", "curr ", "ready", "recv ", "sleep", "susp ",
+		"wait ", "rtime", "fwait"};
+
+	/* For argument '--help', emit help about the 'top' command	*/
+
+	if (nargs == 2 && strncmp(args[1], "--help", 7) == 0) {
+		printf("Use: %s [-d ms] [-n count]\n\n", args[0]);
+		printf("Description:\n");
+		printf("\tDisplays CPU use, context switches, time spent\n");
+		printf("\tblocked, and peak stack use for each process\n");
+		printf("Options:\n");
+		printf("\t-d ms\t time between updates (default 1000)\n");
+		printf("\t-n count\t number of updates, 0 runs forever\n");
+		printf("\t\t (default 10)\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	for (i = 1; i < nargs; i++) {
+		if ((strncmp(args[i], "-d", 3) == 0) && (i + 1 < nargs)) {
+			delay = atoi(args[++i]);
+		} else if ((strncmp(args[i], "-n", 3) == 0) && (i + 1 < nargs)) {
+			count = atoi(args[++i]);
+		} else {
+			fprintf(stderr, "%s: invalid argument\n", args[0]);
+			fprintf(stderr, "Try '%s --help' for more information\n",
+					args[0]);
+			return 1;
+		}
+	}
+	if (delay <= 0) {
+		delay = 1000;
+	}
+
+	topstamp = topsnap(topcyc);
+	for (iter = 0; (count == 0) || (iter < count); iter++) {
+		sleepms(delay);
+		stamp = topsnap(topnow);
+		total = stamp - topstamp;
+
+		printf("\033[2J\033[H");
+		printf("top: update every %d ms, %d processes, up %d s\n\n",
+			delay, prcount, clktime);
+		printf("%3s %-16s %5s %4s %5s %8s %7s %7s %8s %8s %8s %6s\n",
+			"Pid", "Name", "State", "Prio", "%CPU", "CPU ms",
+			"Vol", "Invol", "Wait ms", "Fwait ms", "Sleep ms",
+			"Stack");
+
+		for (i = 0; i < NPROC; i++) {
+			prptr = &proctab[i];
+			if (prptr->prstate == PR_FREE) {
+				continue;
+			}
+
+			/* A slot reused since the last update starts at 0 */
+
+			used = topnow[i] - topcyc[i];
+			if (topnow[i] < topcyc[i]) {
+				used = topnow[i];
+			}
+			permil = topshare(used, total);
+			stk = stkhwm(i);
+
+			printf("%3d %-16s %s %4d %3d.%d %8d %7d %7d %8d %8d %8d ",
+				i, prptr->prname, pstate[(int)prptr->prstate],
+				prptr->prprio, permil / 10, permil % 10,
+				cyc2ms(topnow[i]), prptr->prvolsw,
+				prptr->prinvolsw, cyc2ms(prptr->prwaitcyc),
+				cyc2ms(prptr->prfwaitcyc),
+				cyc2ms(prptr->prsleepcyc));
+			if (stk == SYSERR) {
+				printf("%6s\n", "-");
+			} else {
+				printf("%6d\n", stk);
+			}
+		}
+		memcpy(topcyc, topnow, sizeof(topcyc));
+		topstamp = stamp;
+	}
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ * topsnap - Copy the cycles used by every process, counting the time
+ *	       the current process has run since it was last switched in
+ *------------------------------------------------------------------------
+ */
+static	uint64	topsnap(
+	  uint64	*cyc		/* Array of NPROC to fill in	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	i;			/* Index into proctab		*/
+	uint64	now;			/* Cycle count of the snapshot	*/
+
+	mask = disable();
+	now = getcycles();
+	for (i = 0; i < NPROC; i++) {
+		cyc[i] = proctab[i].prcycles;
+	}
+	cyc[currpid] += now - currstart;
+	restore(mask);
+	return now;
+}
+
+/*------------------------------------------------------------------------
+ * cyc2ms - Convert a count of cycles to milliseconds
+ *------------------------------------------------------------------------
+ */
+static	uint32	cyc2ms(
+	  uint64	cycles		/* Cycles to convert		*/
+	)
+{
+	return (uint32)udiv64(cycles2ns(cycles), 1000000, NULL);
+}
+
+/*------------------------------------------------------------------------
+ * topshare - Return part as tenths of a percent of whole
+ *------------------------------------------------------------------------
+ */
+static	uint32	topshare(
+	  uint64	part,		/* Cycles used by one process	*/
+	  uint64	whole		/* Cycles in the interval	*/
+	)
+{
+	/* udiv64 takes a 32-bit divisor, so scale both down together	*/
+
+	while (whole > 0xffffffffULL) {
+		part >>= 1;
+		whole >>= 1;
+	}
+	if (whole == 0) {
+		return 0;
+	}
+	return (uint32)udiv64(part * 1000, (uint32)whole, NULL);
+}
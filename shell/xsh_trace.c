@@ -0,0 +1,110 @@
+/* xsh_trace.c - xsh_trace */
+
+#include <xinu.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef TRACE
+
+static	const	char	*trname[NTREVENT] = {
+	"none", "ctxsw", "wait", "signal", "fget", "fset",
+	"getmem", "freemem", "intr", "intrend"
+};
+
+static	void	trdump(bool8);
+
+/*------------------------------------------------------------------------
+ * xsh_trace - Start, stop, and dump the kernel event trace
+ *------------------------------------------------------------------------
+ */
+shellcmd xsh_trace(int nargs, char *args[])
+{
+	/* For argument '--help', emit help about the 'trace' command	*/
+
+	if ((nargs == 1) ||
+	    (nargs == 2 && strncmp(args[1], "--help", 7) == 0)) {
+		printf("Use: %s start|stop|status|dump [csv|hex]\n\n",
+								args[0]);
+		printf("Description:\n");
+		printf("\tControls the kernel event trace ring\n");
+		printf("Options:\n");
+		printf("\tstart\t clear the ring and start tracing\n");
+		printf("\tstop\t stop tracing\n");
+		printf("\tstatus\t show whether tracing and record count\n");
+		printf("\tdump csv  print the records as CSV (default)\n");
+		printf("\tdump hex  print each raw record in hex\n");
+		printf("\t--help\t display this help and exit\n");
+		return 0;
+	}
+
+	if (strncmp(args[1], "start", 6) == 0) {
+		trstart();
+	} else if (strncmp(args[1], "stop", 5) == 0) {
+		trstop();
+	} else if (strncmp(args[1], "status", 7) == 0) {
+		printf("tracing %s, %d events recorded, ring holds %d\n",
+			trenabled ? "on" : "off", trnext, NTRACE);
+	} else if (strncmp(args[1], "dump", 5) == 0) {
+		if (nargs == 2 || strncmp(args[2], "csv", 4) == 0) {
+			trdump(FALSE);
+		} else if (strncmp(args[2], "hex", 4) == 0) {
+			trdump(TRUE);
+		} else {
+			fprintf(stderr, "%s: unknown dump format %s\n",
+				args[0], args[2]);
+			return 1;
+		}
+	} else {
+		fprintf(stderr, "%s: unknown operation %s\n", args[0],
+								args[1]);
+		fprintf(stderr, "Try '%s --help' for more information\n",
+				args[0]);
+		return 1;
+	}
+	return 0;
+}
+
+/*------------------------------------------------------------------------
+ * trdump - Print the records in the ring from oldest to newest; tracing
+ *	    is paused while the ring is printed
+ *------------------------------------------------------------------------
+ */
+static	void	trdump(
+	  bool8		hex		/* Print raw records in hex	*/
+	)
+{
+	bool8	was;			/* Tracing state before dump	*/
+	uint32	first, last;		/* Range of records to print	*/
+	uint32	i, j;			/* Walk records and bytes	*/
+	struct	trrec	*trptr;		/* Record being printed		*/
+	byte	*bp;			/* Bytes of a raw record	*/
+
+	was = trenabled;
+	trenabled = FALSE;
+
+	last = trnext;
+	first = (last > NTRACE) ? last - NTRACE : 0;
+	if (!hex) {
+		printf("seq,cycles,event,pid,a,b\n");
+	}
+	for (i = first; i < last; i++) {
+		trptr = &trtab[i & (NTRACE - 1)];
+		if (hex) {
+			bp = (byte *)trptr;
+			for (j = 0; j < sizeof(struct trrec); j++) {
+				printf("%02x", bp[j]);
+			}
+			printf("\n");
+		} else {
+			printf("%d,0x%08x%08x,%s,%d,0x%x,0x%x\n", i,
+				(uint32)(trptr->trcycles >> 32),
+				(uint32)trptr->trcycles,
+				trptr->trevent < NTREVENT ?
+					trname[trptr->trevent] : "?",
+				trptr->trpid, trptr->tra, trptr->trb);
+		}
+	}
+	trenabled = was;
+}
+
+#endif
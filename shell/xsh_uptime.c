@@ -15,6 +15,7 @@ shellcmd xsh_uptime(int nargs, char *args[])
 	uint32	secperday = 86400;	/* seconds in a day		*/
 	uint32	secperhr  =  3600;	/* seconds in an hour		*/
 	uint32	secpermin =    60;	/* seconds in a minute		*/	
+	uint32	nsecs;			/* ns within the current second	*/
 
 	/* For argument '--help', emit help about the 'uptime' command	*/
 
@@ -36,7 +37,9 @@ shellcmd xsh_uptime(int nargs, char *args[])
 		return 1;
 	}
 
-	secs = clktime;		/* total seconds since boot */
+	/* total seconds since boot, from the high-resolution clock */
+
+	secs = (uint32)udiv64(gettime_ns(), 1000000000, &nsecs);
 
 	/* subtract number of whole days */
 
@@ -66,9 +69,7 @@ shellcmd xsh_uptime(int nargs, char *args[])
 		printf(" %d minute(s) ", mins);
 	}
 
-	if (secs > 0) {
-		printf(" %d second(s) ", secs);
-	}
+	printf(" %d.%06d second(s) ", secs, nsecs / 1000);
 	printf("\n");
 
 	return 0;
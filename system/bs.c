@@ -50,6 +50,7 @@ int bs_freedev(int dev) {
     errormsg("bs_freedev freemem failed\n");
     return SYSERR;
   }
+  dev0_blocks = NULL;
 
   return OK;
 
@@ -101,5 +102,20 @@ int bs_bwrite(int dev, int block, int offset, void *buf, int len) {
 
 }
 
+char *bs_baddr(int dev, int block) {
+
+  if (dev != dev0) {
+    errormsg("Unsupported device: %d\n", dev);
+    return NULL;
+  }
+  if (block < 0 || block >= dev0_numblocks) {
+    errormsg("Bad block: %d\n", block);
+    return NULL;
+  }
+
+  return &dev0_blocks[block * dev0_blocksize];
+
+}
+
 #endif /* FS */
 
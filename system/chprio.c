@@ -23,6 +23,13 @@ pri16	chprio(
 	prptr = &proctab[pid];
 	oldprio = prptr->prprio;
 	prptr->prprio = newprio;
+
+	/* A ready process moves to the position for its new priority	*/
+
+	if (prptr->prstate == PR_READY) {
+		rqremove(pid);
+		rqinsert(pid, newprio);
+	}
 	restore(mask);
 	return oldprio;
 }
@@ -47,6 +47,7 @@ syscall	freemem(
 	}
 
 	memlist.mlength += nbytes;
+	trace(TR_FREEMEM, nbytes, blkaddr);
 
 	/* Either coalesce with previous block or add to free list */
 
@@ -0,0 +1,83 @@
+/* freeslab.c - freeslab */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  freeslab  -  Return an object obtained from getslab to its size
+ *		   class, releasing the page once the class has a spare
+ *------------------------------------------------------------------------
+ */
+syscall	freeslab(
+	  char		*blkaddr,	/* Pointer to object		*/
+	  uint32	nbytes		/* Size given to getslab	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	cls;			/* Index of size class		*/
+	struct	slabclass *scptr;	/* Pointer to entry in slabtab	*/
+	struct	slabpage *pgptr;	/* Page that holds the object	*/
+	struct	slabobj	*obj;		/* Object being released	*/
+
+	mask = disable();
+	if ((nbytes == 0) || ((uint32) blkaddr < (uint32) minheap)
+			  || ((uint32) blkaddr > (uint32) maxheap)) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	cls = slabindex(nbytes);
+	if (cls == SYSERR) {		/* Came from getmem		*/
+		restore(mask);
+		return freemem(blkaddr, nbytes);
+	}
+	scptr = &slabtab[cls];
+
+	/* Pages are aligned on their size, so the header is found by	*/
+	/*   truncating the object address				*/
+
+	pgptr = (struct slabpage *)((uint32)blkaddr & ~(scptr->scpagesz - 1));
+	if ((pgptr->spclass != cls) || (pgptr->spinuse == 0)
+	    || ((uint32)blkaddr < (uint32)roundmb(pgptr + 1))) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	/* A full page rejoins the list of pages with free objects	*/
+
+	if (pgptr->spfree == NULL) {
+		pgptr->spprev = NULL;
+		pgptr->spnext = scptr->scpages;
+		if (scptr->scpages != NULL) {
+			scptr->scpages->spprev = pgptr;
+		}
+		scptr->scpages = pgptr;
+	}
+
+	obj = (struct slabobj *)blkaddr;
+	obj->sonext = pgptr->spfree;
+	pgptr->spfree = obj;
+	scptr->scinuse--;
+	scptr->scfrees++;
+
+	/* Keep one empty page per class to avoid carving a page on	*/
+	/*   every allocation; return any others to the free list	*/
+
+	if (--pgptr->spinuse == 0) {
+		if (scptr->scempty == 0) {
+			scptr->scempty++;
+		} else {
+			if (pgptr->spprev == NULL) {
+				scptr->scpages = pgptr->spnext;
+			} else {
+				pgptr->spprev->spnext = pgptr->spnext;
+			}
+			if (pgptr->spnext != NULL) {
+				pgptr->spnext->spprev = pgptr->spprev;
+			}
+			scptr->scnpages--;
+			freemem((char *)pgptr, scptr->scpagesz);
+		}
+	}
+	restore(mask);
+	return OK;
+}
@@ -16,6 +16,15 @@ extern int dev0;
 
 char block_cache[512];
 
+// Every inode is kept in memory; inode_dirty[b] is set when inode block
+// b has changes that _fs_flush_inodes hasn't written back yet.
+static inode_t *inode_cache;
+static char *inode_dirty;
+
+static struct dirindex **dir_index; // Per inode: a directory's name index, NULL until it is used
+
+static bool8 fs_made = FALSE; // fs_mkfs has run and fs_freefs hasn't since
+
 #define SB_BLK 0 // Superblock
 #define BM_BLK 1 // Bitmapblock
 
@@ -28,75 +37,629 @@ filetable_t oft[NUM_FD]; // open file table
 #define NUM_INODE_BLOCKS (( (fsd.ninodes % INODES_PER_BLOCK) == 0) ? fsd.ninodes / INODES_PER_BLOCK : (fsd.ninodes / INODES_PER_BLOCK) + 1)
 #define FIRST_INODE_BLOCK 2
 
+#define PTRS_PER_BLOCK (fsd.blocksz / sizeof(int))
+#define MAX_FILE_BLOCKS (INODEDIRECTBLOCKS + PTRS_PER_BLOCK + PTRS_PER_BLOCK * PTRS_PER_BLOCK)
+
+/* What to do when a block along a lookup is missing */
+#define FS_LOOKUP         0 // Nothing: the lookup gives 0
+#define FS_ALLOC_DATA     1 // Allocate a data block
+#define FS_ALLOC_INDIRECT 2 // Allocate a zeroed indirect block
+#define FS_ALLOC_MAP      3 // Allocate the indirect blocks only
+
 /**
  * Helper functions
  */
-int _fs_fileblock_to_diskblock(int dev, int fd, int fileblock) {
-  int diskblock;
 
-  if (fileblock >= INODEDIRECTBLOCKS) {
-    errormsg("No indirect block support! (%d >= %d)\n", fileblock, INODEBLOCKS - 2);
+/**
+ * The free mask as 32-bit words, lowest block in the high-order bit like
+ * the bytes, so the first free block of word w is 32*w + clz(~w).
+ */
+static uint32 _fs_maskword(int i) {
+  unsigned char *m = (unsigned char *) &fsd.freemask[i * 4];
+
+  return ((uint32) m[0] << 24) | ((uint32) m[1] << 16) | ((uint32) m[2] << 8) | m[3];
+}
+
+/* First free block at or after start, wrapping around the device */
+static int _fs_find_free(int start) {
+  int nwords = fsd.freemaskbytes / 4;
+  int i, n;
+  uint32 w;
+
+  // Blocks before start in its word count as used on the first pass
+  i = start / 32;
+  w = _fs_maskword(i) | ~(0xFFFFFFFF >> (start % 32));
+  for (n = 0; n <= nwords; n++) {
+    if (w != 0xFFFFFFFF) {
+      return i * 32 + __builtin_clz(~w);
+    }
+    i = (i + 1) % nwords;
+    w = _fs_maskword(i);
+  }
+  return SYSERR;
+}
+
+/* Start of the first run of len free blocks, skipping whole words where it can */
+static int _fs_find_run(int len) {
+  int b, run;
+  uint32 w;
+
+  run = 0;
+  b = 0;
+  while (b < fsd.nblocks) {
+    if ((b % 32) == 0) {
+      w = _fs_maskword(b / 32);
+      if (w == 0) {
+        run += 32;
+        b += 32;
+        if (run >= len) {
+          return b - run;
+        }
+        continue;
+      }
+      if (w == 0xFFFFFFFF) {
+        run = 0;
+        b += 32;
+        continue;
+      }
+    }
+    if (fs_getmaskbit(b)) {
+      run = 0;
+    } else if (++run == len) {
+      return b - len + 1;
+    }
+    b++;
+  }
+  return SYSERR;
+}
+
+/**
+ * Claim a block for an inode: the block after the one it got last if
+ * that is free, so files are laid out contiguously, otherwise the next
+ * free one from the allocation hint.  Indirect blocks start out all
+ * zero (no blocks).
+ */
+static int _fs_alloc_block(blockmap_t *bm, int zero) {
+  int b;
+
+  b = bm->goal;
+  if (b <= 0 || b >= fsd.nblocks || fs_getmaskbit(b)) {
+    b = _fs_find_free(fsd.allochint);
+    if (b == SYSERR) {
+      errormsg("No free blocks\n");
+      return SYSERR;
+    }
+  }
+  fs_setmaskbit(b);
+  fsd.allochint = (b + 1) % fsd.nblocks;
+  bm->goal = b + 1;
+
+  if (zero) {
+    memset(block_cache, 0, fsd.blocksz);
+    bs_bwrite(dev0, b, 0, block_cache, fsd.blocksz);
+  }
+  return b;
+}
+
+/* Block number in slot of inode in, filling an empty slot if asked */
+static int _fs_inode_slot(inode_t *in, blockmap_t *bm, int slot, int alloc) {
+  int b;
+
+  if (in->blocks[slot] == 0 && alloc != FS_LOOKUP) {
+    if ((b = _fs_alloc_block(bm, alloc == FS_ALLOC_INDIRECT)) == SYSERR) {
+      return SYSERR;
+    }
+    in->blocks[slot] = b;
+  }
+  return in->blocks[slot];
+}
+
+/* Block number in slot of indirect block blk, filling an empty slot if asked */
+static int _fs_indirect_slot(blockmap_t *bm, int blk, int slot, int alloc) {
+  int b;
+
+  bs_bread(dev0, blk, slot * sizeof(int), &b, sizeof(int));
+  if (b == 0 && alloc != FS_LOOKUP) {
+    if ((b = _fs_alloc_block(bm, alloc == FS_ALLOC_INDIRECT)) == SYSERR) {
+      return SYSERR;
+    }
+    bs_bwrite(dev0, blk, slot * sizeof(int), &b, sizeof(int));
+  }
+  return b;
+}
+
+/**
+ * Map a file block to its disk block, allocating the data block and any
+ * indirect blocks on the way when alloc is FS_ALLOC_DATA (just the
+ * indirect ones for FS_ALLOC_MAP).  Returns 0 for a block that does not
+ * exist yet.
+ *
+ * The first INODEDIRECTBLOCKS blocks are in the inode.  blocks[INODE_INDIRECT]
+ * holds the numbers of the next PTRS_PER_BLOCK, and blocks[INODE_DINDIRECT]
+ * the numbers of indirect blocks for PTRS_PER_BLOCK^2 more.  The indirect
+ * block of the last lookup stays in bm, so sequential access finds its
+ * block with a single read.
+ */
+static int _fs_map_block(inode_t *in, blockmap_t *bm, int fileblock, int alloc) {
+  int ptrs = PTRS_PER_BLOCK;
+  int ialloc = (alloc == FS_LOOKUP) ? FS_LOOKUP : FS_ALLOC_INDIRECT;
+  int fb, ind, base;
+
+  if (alloc == FS_ALLOC_MAP) {
+    alloc = FS_LOOKUP;
+  }
+
+  if (fileblock < 0 || fileblock >= MAX_FILE_BLOCKS) {
+    errormsg("File block out of range (%d)\n", fileblock);
     return SYSERR;
   }
+  if (fileblock < INODEDIRECTBLOCKS) {
+    return _fs_inode_slot(in, bm, fileblock, alloc);
+  }
 
-  // Get the logical block address
-  diskblock = oft[fd].in.blocks[fileblock];
+  if (bm->indblk == 0 || fileblock < bm->indbase || fileblock >= bm->indbase + ptrs) {
+    fb = fileblock - INODEDIRECTBLOCKS;
+    if (fb < ptrs) {
+      ind = _fs_inode_slot(in, bm, INODE_INDIRECT, ialloc);
+      base = INODEDIRECTBLOCKS;
+    } else {
+      fb -= ptrs;
+      ind = _fs_inode_slot(in, bm, INODE_DINDIRECT, ialloc);
+      if (ind > 0) {
+        ind = _fs_indirect_slot(bm, ind, fb / ptrs, ialloc);
+      }
+      base = INODEDIRECTBLOCKS + ptrs + (fb / ptrs) * ptrs;
+    }
+    if (ind == SYSERR || ind == 0) {
+      return ind;
+    }
+    bm->indblk = ind;
+    bm->indbase = base;
+  }
 
-  return diskblock;
+  return _fs_indirect_slot(bm, bm->indblk, fileblock - bm->indbase, alloc);
+}
+
+/**
+ * Map up to max file blocks from fileblock, stopping where their disk
+ * blocks stop being consecutive, so the caller can move them with one
+ * memcpy.  *first gets the first disk block.  Returns how many blocks
+ * are in the run, 0 if fileblock does not exist, or SYSERR.
+ */
+static int _fs_extent(inode_t *in, blockmap_t *bm, int fileblock, int max, int alloc, int *first) {
+  int n, b;
+
+  if ((*first = _fs_map_block(in, bm, fileblock, alloc)) <= 0) {
+    return *first;
+  }
+  for (n = 1; n < max && fileblock + n < MAX_FILE_BLOCKS; n++) {
+    b = _fs_map_block(in, bm, fileblock + n, alloc);
+    if (b != *first + n) {
+      break; // Not there, out of space or elsewhere: the next call picks it up
+    }
+  }
+  return n;
+}
+
+int _fs_fileblock_to_diskblock(int dev, int fd, int fileblock) {
+  if (dev != dev0) {
+    errormsg("Unsupported device: %d\n", dev);
+    return SYSERR;
+  }
+
+  // Get the logical block address
+  return _fs_map_block(&oft[fd].in, &oft[fd].map, fileblock, FS_LOOKUP);
 }
 
 /**
  * Filesystem functions
  */
 int _fs_get_inode_by_num(int dev, int inode_number, inode_t *out) {
-  int bl, inn;
-  int inode_off;
-
   if (dev != dev0) {
     errormsg("Unsupported device: %d\n", dev);
     return SYSERR;
   }
-  if (inode_number > fsd.ninodes) {
-    errormsg("inode %d out of range (> %s)\n", inode_number, fsd.ninodes);
+  if (inode_number < 0 || inode_number >= fsd.ninodes) {
+    errormsg("inode %d out of range (>= %d)\n", inode_number, fsd.ninodes);
     return SYSERR;
   }
 
-  bl  = inode_number / INODES_PER_BLOCK;
-  inn = inode_number % INODES_PER_BLOCK;
-  bl += FIRST_INODE_BLOCK;
-
-  inode_off = inn * sizeof(inode_t);
-
-  bs_bread(dev0, bl, 0, &block_cache[0], fsd.blocksz);
-  memcpy(out, &block_cache[inode_off], sizeof(inode_t));
+  memcpy(out, &inode_cache[inode_number], sizeof(inode_t));
 
   return OK;
 
 }
 
 int _fs_put_inode_by_num(int dev, int inode_number, inode_t *in) {
-  int bl, inn;
-
   if (dev != dev0) {
     errormsg("Unsupported device: %d\n", dev);
     return SYSERR;
   }
-  if (inode_number > fsd.ninodes) {
-    errormsg("inode %d out of range (> %d)\n", inode_number, fsd.ninodes);
+  if (inode_number < 0 || inode_number >= fsd.ninodes) {
+    errormsg("inode %d out of range (>= %d)\n", inode_number, fsd.ninodes);
     return SYSERR;
   }
 
-  bl = inode_number / INODES_PER_BLOCK;
-  inn = inode_number % INODES_PER_BLOCK;
-  bl += FIRST_INODE_BLOCK;
+  memcpy(&inode_cache[inode_number], in, sizeof(inode_t));
+  inode_dirty[inode_number / INODES_PER_BLOCK] = 1;
+
+  return OK;
+}
+
+/* Write each dirty inode block back to the device with one write */
+static void _fs_flush_inodes(void) {
+  int bl, n;
+
+  for (bl = 0; bl < NUM_INODE_BLOCKS; bl++) {
+    if (inode_dirty[bl]) {
+      n = fsd.ninodes - bl * INODES_PER_BLOCK;
+      if (n > INODES_PER_BLOCK) {
+        n = INODES_PER_BLOCK;
+      }
+      memset(block_cache, 0, fsd.blocksz);
+      memcpy(block_cache, &inode_cache[bl * INODES_PER_BLOCK], n * sizeof(inode_t));
+      bs_bwrite(dev0, FIRST_INODE_BLOCK + bl, 0, block_cache, fsd.blocksz);
+      inode_dirty[bl] = 0;
+    }
+  }
+}
+
+/* Take a free inode and set it up as an empty file or directory */
+static int _fs_new_inode(int type) {
+  int i;
 
-  bs_bread(dev0, bl, 0, block_cache, fsd.blocksz);
-  memcpy(&block_cache[(inn*sizeof(inode_t))], in, sizeof(inode_t));
-  bs_bwrite(dev0, bl, 0, block_cache, fsd.blocksz);
+  for (i = 0; i < fsd.ninodes; i++) {
+    if (inode_cache[i].id == EMPTY) {
+      memset(&inode_cache[i], 0, sizeof(inode_t)); // 0: no block (block 0 is the superblock)
+      inode_cache[i].id = i;
+      inode_cache[i].type = type;
+      inode_cache[i].nlink = 1;
+      inode_cache[i].device = dev0;
+      inode_dirty[i / INODES_PER_BLOCK] = 1;
+      fsd.inodes_used++;
+      return i;
+    }
+  }
+  errormsg("No more inodes available\n");
+  return SYSERR;
+}
+
+/* Give back block blk, and first the blocks it points to if it is an indirect block of the given depth */
+static void _fs_free_tree(int blk, int depth) {
+  int i, b;
 
+  if (blk <= 0) {
+    return;
+  }
+  for (i = 0; depth > 0 && i < PTRS_PER_BLOCK; i++) {
+    bs_bread(dev0, blk, i * sizeof(int), &b, sizeof(int));
+    _fs_free_tree(b, depth - 1);
+  }
+  fs_clearmaskbit(blk);
+}
+
+static void _fs_free_inode(int ino) {
+  int i;
+
+  // Data blocks, the indirect block and the double-indirect tree
+  for (i = 0; i < INODEDIRECTBLOCKS; i++) {
+    _fs_free_tree(inode_cache[ino].blocks[i], 0);
+  }
+  _fs_free_tree(inode_cache[ino].blocks[INODE_INDIRECT], 1);
+  _fs_free_tree(inode_cache[ino].blocks[INODE_DINDIRECT], 2);
+  memset(inode_cache[ino].blocks, 0, sizeof(inode_cache[ino].blocks));
+
+  inode_cache[ino].id = EMPTY;
+  inode_cache[ino].size = 0;
+  inode_dirty[ino / INODES_PER_BLOCK] = 1;
+  fsd.inodes_used--;
+}
+
+/**
+ * Directories
+ *
+ * A directory is an inode of type INODE_TYPE_DIR whose data blocks hold
+ * dirent_t slots, DIRENTS_PER_BLOCK to a block.  The first time a
+ * directory is used its names are hashed into a dirindex that stays in
+ * memory with it, so finding a name is one probe and one dirent read
+ * however many entries the directory has.  The index also keeps the
+ * directory's empty slots on a stack, so adding a name never has to
+ * search the dirents for one.
+ */
+#define DIRENTS_PER_BLOCK (fsd.blocksz / sizeof(dirent_t))
+#define DH_FREE (-1) // Bucket never used
+#define DH_GONE (-2) // Bucket whose name was removed
+
+struct dirhash {
+  uint32 hash;
+  int slot;            // Dirent slot, or DH_FREE / DH_GONE
+};
+
+struct dirindex {
+  int nslots;          // Dirent slots in the directory's blocks
+  int nentries;        // Slots in use
+  int *free;           // Empty slots below nslots, nfree of them
+  int nfree;
+  int freecap;         // Room in free
+  int size;            // Buckets in tab, a power of two
+  int ngone;           // Buckets that are DH_GONE
+  struct dirhash *tab;
+  blockmap_t map;      // Block lookups for the directory's inode
+};
+
+static uint32 _fs_namehash(char *name) {
+  uint32 h = 2166136261U; // FNV-1a
+  int i;
+
+  for (i = 0; i < FILENAMELEN && name[i] != '\0'; i++) {
+    h = (h ^ (unsigned char) name[i]) * 16777619U;
+  }
+  return h;
+}
+
+/* Read or write dirent slot of directory dir, adding blocks to it as needed */
+static int _fs_dirent_io(int dir, int slot, dirent_t *de, int write) {
+  int blk, off;
+
+  blk = _fs_map_block(&inode_cache[dir], &dir_index[dir]->map, slot / DIRENTS_PER_BLOCK,
+                      write ? FS_ALLOC_DATA : FS_LOOKUP);
+  if (blk <= 0) {
+    return SYSERR;
+  }
+  off = (slot % DIRENTS_PER_BLOCK) * sizeof(dirent_t);
+  if (write) {
+    inode_dirty[dir / INODES_PER_BLOCK] = 1; // The directory may have new blocks
+    return bs_bwrite(dev0, blk, off, de, sizeof(dirent_t));
+  }
+  return bs_bread(dev0, blk, off, de, sizeof(dirent_t));
+}
+
+static void _fs_dirhash_put(struct dirindex *di, uint32 hash, int slot) {
+  int i, mask = di->size - 1;
+
+  for (i = hash & mask; di->tab[i].slot >= 0; i = (i + 1) & mask);
+  if (di->tab[i].slot == DH_GONE) {
+    di->ngone--;
+  }
+  di->tab[i].hash = hash;
+  di->tab[i].slot = slot;
+}
+
+/* Remember that slot is empty; a slot that can't be remembered stays unused */
+static void _fs_dirfree_push(struct dirindex *di, int slot) {
+  int *old = di->free;
+  int cap = (di->freecap == 0) ? 16 : di->freecap * 2;
+
+  if (di->nfree == di->freecap) {
+    if ((di->free = (int *) getmem(cap * sizeof(int))) == (void *) SYSERR) {
+      di->free = old;
+      return;
+    }
+    if (old != NULL) {
+      memcpy(di->free, old, di->nfree * sizeof(int));
+      freemem((char *) old, di->freecap * sizeof(int));
+    }
+    di->freecap = cap;
+  }
+  di->free[di->nfree++] = slot;
+}
+
+/* A table of size buckets, all DH_FREE */
+static struct dirhash *_fs_dirhash_alloc(int size) {
+  struct dirhash *tab;
+  int i;
+
+  if ((tab = (struct dirhash *) getmem(size * sizeof(struct dirhash))) == (void *) SYSERR) {
+    errormsg("dirhash memget failed\n");
+    return NULL;
+  }
+  for (i = 0; i < size; i++) {
+    tab[i].slot = DH_FREE;
+  }
+  return tab;
+}
+
+/* Make room for one more name, rehashing at least twice as big as the entries */
+static int _fs_dirhash_grow(struct dirindex *di) {
+  struct dirhash *old = di->tab;
+  int oldsize = di->size;
+  int size = di->size;
+  int i;
+
+  if ((di->nentries + di->ngone + 1) * 4 <= size * 3) {
+    return OK;
+  }
+  while ((di->nentries + 1) * 2 > size) {
+    size *= 2;
+  }
+  if ((di->tab = _fs_dirhash_alloc(size)) == NULL) {
+    di->tab = old;
+    return SYSERR;
+  }
+  di->size = size;
+  di->ngone = 0;
+  for (i = 0; i < oldsize; i++) {
+    if (old[i].slot >= 0) {
+      _fs_dirhash_put(di, old[i].hash, old[i].slot);
+    }
+  }
+  freemem((char *) old, oldsize * sizeof(struct dirhash));
   return OK;
 }
 
+/* The name index of directory dir, built from its entries the first time */
+static struct dirindex *_fs_dir(int dir) {
+  struct dirindex *di;
+  dirent_t de;
+  int slot, size;
+
+  if (dir_index[dir] != NULL) {
+    return dir_index[dir];
+  }
+  if ((di = (struct dirindex *) getmem(sizeof(struct dirindex))) == (void *) SYSERR) {
+    errormsg("dirindex memget failed\n");
+    return NULL;
+  }
+  di->nslots = inode_cache[dir].size / sizeof(dirent_t);
+  di->nentries = 0;
+  di->free = NULL;
+  di->nfree = 0;
+  di->freecap = 0;
+  di->ngone = 0;
+  di->map.indblk = 0;
+  di->map.indbase = 0;
+  di->map.goal = 0;
+  for (size = 16; size < di->nslots * 2; size *= 2);
+  if ((di->tab = _fs_dirhash_alloc(size)) == NULL) {
+    freemem((char *) di, sizeof(struct dirindex));
+    return NULL;
+  }
+  di->size = size;
+
+  dir_index[dir] = di;
+  for (slot = 0; slot < di->nslots; slot++) {
+    _fs_dirent_io(dir, slot, &de, 0);
+    if (de.inode_num == EMPTY) {
+      _fs_dirfree_push(di, slot);
+    } else {
+      _fs_dirhash_put(di, _fs_namehash(de.name), slot);
+      di->nentries++;
+    }
+  }
+  return di;
+}
+
+/* Inode called name in directory dir, or SYSERR; *bucket gets its hash bucket */
+static int _fs_dir_lookup(int dir, char *name, int *bucket) {
+  struct dirindex *di;
+  dirent_t de;
+  uint32 hash;
+  int i, mask;
+
+  if ((di = _fs_dir(dir)) == NULL) {
+    return SYSERR;
+  }
+  hash = _fs_namehash(name);
+  mask = di->size - 1;
+  for (i = hash & mask; di->tab[i].slot != DH_FREE; i = (i + 1) & mask) {
+    if (di->tab[i].slot >= 0 && di->tab[i].hash == hash) {
+      _fs_dirent_io(dir, di->tab[i].slot, &de, 0);
+      if (strncmp(de.name, name, FILENAMELEN) == 0) {
+        if (bucket != NULL) {
+          *bucket = i;
+        }
+        return de.inode_num;
+      }
+    }
+  }
+  return SYSERR;
+}
+
+/* Enter name for inode ino in directory dir, in a freed slot or a new one at the end */
+static int _fs_dir_add(int dir, char *name, int ino) {
+  struct dirindex *di;
+  dirent_t de;
+  int slot;
+
+  if ((di = _fs_dir(dir)) == NULL || _fs_dirhash_grow(di) == SYSERR) {
+    return SYSERR;
+  }
+  slot = (di->nfree > 0) ? di->free[di->nfree - 1] : di->nslots;
+  de.inode_num = ino;
+  memset(de.name, 0, FILENAMELEN);
+  strncpy(de.name, name, FILENAMELEN);
+  if (_fs_dirent_io(dir, slot, &de, 1) == SYSERR) {
+    errormsg("No space to grow directory %d\n", dir);
+    return SYSERR;
+  }
+  if (slot == di->nslots) {
+    di->nslots++;
+    inode_cache[dir].size = di->nslots * sizeof(dirent_t);
+  } else {
+    di->nfree--;
+  }
+  di->nentries++;
+  _fs_dirhash_put(di, _fs_namehash(de.name), slot);
+  return OK;
+}
+
+/* Take name out of directory dir; returns the inode it named */
+static int _fs_dir_remove(int dir, char *name) {
+  struct dirindex *di;
+  dirent_t de;
+  int ino, bucket, slot;
+
+  if ((ino = _fs_dir_lookup(dir, name, &bucket)) == SYSERR) {
+    return SYSERR;
+  }
+  di = dir_index[dir];
+  slot = di->tab[bucket].slot;
+  de.inode_num = EMPTY;
+  memset(de.name, 0, FILENAMELEN);
+  _fs_dirent_io(dir, slot, &de, 1);
+  di->tab[bucket].slot = DH_GONE;
+  di->ngone++;
+  di->nentries--;
+  _fs_dirfree_push(di, slot);
+  return ino;
+}
+
+/**
+ * Find the directory that holds the last component of path, and copy
+ * that component into name (FILENAMELEN + 1 bytes).
+ */
+static int _fs_path_parent(char *path, char *name) {
+  int dir = fsd.root;
+  char *end;
+
+  if (path == NULL) {
+    return SYSERR;
+  }
+  while (1) {
+    while (*path == '/') {
+      path++;
+    }
+    for (end = path; *end != '\0' && *end != '/'; end++);
+    if (end == path || end - path > FILENAMELEN) {
+      errormsg("Bad path component\n");
+      return SYSERR;
+    }
+    memset(name, 0, FILENAMELEN + 1);
+    memcpy(name, path, end - path);
+    while (*end == '/') {
+      end++;
+    }
+    if (*end == '\0') {
+      return dir;
+    }
+    dir = _fs_dir_lookup(dir, name, NULL);
+    if (dir == SYSERR || inode_cache[dir].type != INODE_TYPE_DIR) {
+      errormsg("No such directory: %s\n", name);
+      return SYSERR;
+    }
+    path = end;
+  }
+}
+
+/* Inode that path names; "" and "/" are the root */
+static int _fs_path_lookup(char *path) {
+  char name[FILENAMELEN + 1];
+  char *p;
+  int dir;
+
+  if (path == NULL) {
+    return SYSERR;
+  }
+  for (p = path; *p == '/'; p++);
+  if (*p == '\0') {
+    return fsd.root;
+  }
+  if ((dir = _fs_path_parent(path, name)) == SYSERR) {
+    return SYSERR;
+  }
+  return _fs_dir_lookup(dir, name, NULL);
+}
+
 int fs_mkfs(int dev, int num_inodes) {
   int i;
 
@@ -114,14 +677,34 @@ int fs_mkfs(int dev, int num_inodes) {
     fsd.ninodes = num_inodes;
   }
 
+  // Whole words, so the mask can be searched a word at a time
   i = fsd.nblocks;
-  while ( (i % 8) != 0) { i++; }
+  while ( (i % 32) != 0) { i++; }
   fsd.freemaskbytes = i / 8;
 
   if ((fsd.freemask = getmem(fsd.freemaskbytes)) == (void *) SYSERR) {
     errormsg("fs_mkfs memget failed\n");
     return SYSERR;
   }
+  if ((inode_cache = (inode_t *) getmem(fsd.ninodes * sizeof(inode_t))) == (void *) SYSERR) {
+    errormsg("fs_mkfs memget failed\n");
+    freemem(fsd.freemask, fsd.freemaskbytes);
+    return SYSERR;
+  }
+  if ((inode_dirty = getmem(NUM_INODE_BLOCKS)) == (void *) SYSERR) {
+    errormsg("fs_mkfs memget failed\n");
+    freemem((char *) inode_cache, fsd.ninodes * sizeof(inode_t));
+    freemem(fsd.freemask, fsd.freemaskbytes);
+    return SYSERR;
+  }
+  if ((dir_index = (struct dirindex **) getmem(fsd.ninodes * sizeof(struct dirindex *))) == (void *) SYSERR) {
+    errormsg("fs_mkfs memget failed\n");
+    freemem(inode_dirty, NUM_INODE_BLOCKS);
+    freemem((char *) inode_cache, fsd.ninodes * sizeof(inode_t));
+    freemem(fsd.freemask, fsd.freemaskbytes);
+    return SYSERR;
+  }
+  memset(dir_index, 0, fsd.ninodes * sizeof(struct dirindex *));
 
   /* zero the free mask */
   for(i = 0; i < fsd.freemaskbytes; i++) {
@@ -136,25 +719,30 @@ int fs_mkfs(int dev, int num_inodes) {
 
   /* write the free block bitmask in BM_BLK, mark block used */
   fs_setmaskbit(BM_BLK);
+  /* the inode table follows it; keep file data out of it */
+  for (i = 0; i < NUM_INODE_BLOCKS; i++) {
+    fs_setmaskbit(FIRST_INODE_BLOCK + i);
+  }
+  /* the padding past the last block is never free */
+  for (i = fsd.nblocks; i < fsd.freemaskbytes * 8; i++) {
+    fs_setmaskbit(i);
+  }
+  fsd.allochint = FIRST_INODE_BLOCK + NUM_INODE_BLOCKS;
   bs_bwrite(dev0, BM_BLK, 0, fsd.freemask, fsd.freemaskbytes);
 
-  // Initialize all inode IDs to EMPTY
-  inode_t tmp_in;
+  // Initialize all inodes to EMPTY, then write the table one block at a time
+  memset(inode_cache, 0, fsd.ninodes * sizeof(inode_t));
   for (i = 0; i < fsd.ninodes; i++) {
-    _fs_get_inode_by_num(dev0, i, &tmp_in);
-    tmp_in.id = EMPTY;
-    _fs_put_inode_by_num(dev0, i, &tmp_in);
-  }
-  fsd.root_dir.numentries = 0;
-  for (i = 0; i < DIRECTORY_SIZE; i++) {
-    fsd.root_dir.entry[i].inode_num = EMPTY;
-    memset(fsd.root_dir.entry[i].name, 0, FILENAMELEN);
+    inode_cache[i].id = EMPTY;
   }
+  fsd.root = _fs_new_inode(INODE_TYPE_DIR);
+  memset(inode_dirty, 1, NUM_INODE_BLOCKS);
+  _fs_flush_inodes();
 
   for (i = 0; i < NUM_FD; i++) {
     oft[i].state     = 0;
     oft[i].fileptr   = 0;
-    oft[i].de        = NULL;
+    memset(&oft[i].de, 0, sizeof(dirent_t));
     oft[i].in.id     = EMPTY;
     oft[i].in.type   = 0;
     oft[i].in.nlink  = 0;
@@ -162,12 +750,45 @@ int fs_mkfs(int dev, int num_inodes) {
     oft[i].in.size   = 0;
     memset(oft[i].in.blocks, 0, sizeof(oft[i].in.blocks));
     oft[i].flag      = 0;
+    oft[i].map.indblk  = 0;
+    oft[i].map.indbase = 0;
+    oft[i].map.goal    = 0;
   }
 
+  fs_made = TRUE;
   return OK;
 }
 
+bool8 fs_mounted(int dev) {
+  return (dev == dev0 && fs_made && dev0_blocks != NULL);
+}
+
 int fs_freefs(int dev) {
+  int i;
+
+  if (!fs_mounted(dev)) {
+    errormsg("No filesystem on device: %d\n", dev);
+    return SYSERR;
+  }
+  fs_made = FALSE;
+
+  _fs_flush_inodes();
+  for (i = 0; i < fsd.ninodes; i++) {
+    if (dir_index[i] != NULL) {
+      freemem((char *) dir_index[i]->tab, dir_index[i]->size * sizeof(struct dirhash));
+      if (dir_index[i]->free != NULL) {
+        freemem((char *) dir_index[i]->free, dir_index[i]->freecap * sizeof(int));
+      }
+      freemem((char *) dir_index[i], sizeof(struct dirindex));
+    }
+  }
+  if (freemem((char *) dir_index, fsd.ninodes * sizeof(struct dirindex *)) == SYSERR) {
+    return SYSERR;
+  }
+  if (freemem((char *) inode_cache, fsd.ninodes * sizeof(inode_t)) == SYSERR
+      || freemem(inode_dirty, NUM_INODE_BLOCKS) == SYSERR) {
+    return SYSERR;
+  }
   if (freemem(fsd.freemask, fsd.freemaskbytes) == SYSERR) {
     return SYSERR;
   }
@@ -182,16 +803,13 @@ void fs_print_oft(void) {
   int i;
 
   printf ("\n\033[35moft[]\033[39m\n");
-  printf ("%3s  %5s  %7s  %8s  %6s  %5s  %4s  %s\n", "Num", "state", "fileptr", "de", "de.num", "in.id", "flag", "de.name");
+  printf ("%3s  %5s  %7s  %6s  %5s  %4s  %s\n", "Num", "state", "fileptr", "de.num", "in.id", "flag", "de.name");
   for (i = 0; i < NUM_FD; i++) {
-    if (oft[i].de != NULL) printf ("%3d  %5d  %7d  %8d  %6d  %5d  %4d  %s\n", i, oft[i].state, oft[i].fileptr, oft[i].de, oft[i].de->inode_num, oft[i].in.id, oft[i].flag, oft[i].de->name);
+    if (oft[i].in.id != EMPTY) printf ("%3d  %5d  %7d  %6d  %5d  %4d  %s\n", i, oft[i].state, oft[i].fileptr, oft[i].de.inode_num, oft[i].in.id, oft[i].flag, oft[i].de.name);
   }
 
-  printf ("\n\033[35mfsd.root_dir.entry[] (numentries: %d)\033[39m\n", fsd.root_dir.numentries);
-  printf ("%3s  %3s  %s\n", "ID", "id", "filename");
-  for (i = 0; i < DIRECTORY_SIZE; i++) {
-    if (fsd.root_dir.entry[i].inode_num != EMPTY) printf("%3d  %3d  %s\n", i, fsd.root_dir.entry[i].inode_num, fsd.root_dir.entry[i].name);
-  }
+  printf ("\n\033[35mroot directory (inode %d)\033[39m\n", fsd.root);
+  fs_print_dir();
   printf("\n");
 }
 
@@ -199,7 +817,7 @@ void fs_print_inode(int fd) {
   int i;
 
   printf("\n\033[35mInode FS=%d\033[39m\n", fd);
-  printf("Name:    %s\n", oft[fd].de->name);
+  printf("Name:    %s\n", oft[fd].de.name);
   printf("State:   %d\n", oft[fd].state);
   printf("Flag:    %d\n", oft[fd].flag);
   printf("Fileptr: %d\n", oft[fd].fileptr);
@@ -250,11 +868,12 @@ void fs_print_fsd(void) {
 }
 
 void fs_print_dir(void) {
-  int i;
+  dirent_t de;
+  int pos = 0;
 
-  printf("%22s  %9s  %s\n", "DirectoryEntry", "inode_num", "name");
-  for (i = 0; i < DIRECTORY_SIZE; i++) {
-    printf("fsd.root_dir.entry[%2d]  %9d  %s\n", i, fsd.root_dir.entry[i].inode_num, fsd.root_dir.entry[i].name);
+  printf("%9s  %s\n", "inode_num", "name");
+  while (fs_readdir("/", &pos, &de) == OK) {
+    printf("%9d  %s\n", de.inode_num, de.name);
   }
 }
 
@@ -311,18 +930,22 @@ void fs_printfreemask(void) { // print block bitmask
 
 
 int fs_open(char *filename, int flags) {
-	// Make sure filename isn't empty
-	if (strncmp(filename, "", FILENAMELEN) == 0) {
-		errormsg("fs_open: filename cannot be empty!\n");
+	// Check flags for validity
+	if (!((flags == O_RDONLY) || (flags == O_WRONLY) || (flags == O_RDWR))) {
+		errormsg("fs_open: invalid flags (permissions)\n");
 		return SYSERR;
 	}
-	else if (strlen(filename) > FILENAMELEN) {
-		errormsg("fs_open: filename too long\n");
+
+	// Walk the path to the file's directory entry, then the inode_num
+	char name[FILENAMELEN + 1];
+	int dir, inode_num;
+	if ((dir = _fs_path_parent(filename, name)) == SYSERR
+	    || (inode_num = _fs_dir_lookup(dir, name, NULL)) == SYSERR) {
+		errormsg("fs_open: file not found\n");
 		return SYSERR;
 	}
-	// Check flags for validity
-	if (!((flags == O_RDONLY) || (flags == O_WRONLY) || (flags == O_RDWR))) {
-		errormsg("fs_open: invalid flags (permissions)\n");
+	if (inode_cache[inode_num].type != INODE_TYPE_FILE) {
+		errormsg("fs_open: %s is a directory\n", name);
 		return SYSERR;
 	}
 	
@@ -330,52 +953,47 @@ int fs_open(char *filename, int flags) {
 	// Make sure the file isn't already open
 	int i;
 	for (i = 0; i < NUM_FD; i++) {
-		if (oft[i].de != NULL && ((strncmp(filename, (oft[i].de)->name, FILENAMELEN)) == 0)) {
-			// Matching filename in filetable already
+		if (oft[i].in.id == inode_num) {
+			// Matching file in filetable already
 			if (oft[i].state == FSTATE_OPEN) {
 				errormsg("fs_open: file already open\n");
 				return SYSERR;
 			}
 			else {
-				// (re)open it
+				// (re)open it from the start, under the name it was opened by this time
 				oft[i].state = FSTATE_OPEN;
 				oft[i].flag = flags;
+				oft[i].fileptr = 0;
+				memcpy(oft[i].de.name, name, FILENAMELEN);
 				return i;
 			}
 		}
 	}
 
-	// find the file from root dir to get the dirent, then the inode_num
-	char file_found = 0;
-	dirent_t* file_dirent;
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		file_dirent = &(fsd.root_dir.entry[i]);
-		if (strncmp(file_dirent->name, filename, FILENAMELEN) == 0) {
-			file_found = 1;
-			break;
-		} 
-	}
-	if (!file_found) {
-		errormsg("fs_open: file not found\n");
-		return SYSERR;
-	}
-	// Get a free filetable in oft;
-	int fd;
-	for (fd = 0; fd < NUM_FD; fd++) {
-		if (oft[fd].de == NULL && oft[fd].in.id == EMPTY) {
+	// Get a free filetable in oft, or else one a closed file left behind
+	int fd = -1;
+	for (i = 0; i < NUM_FD; i++) {
+		if (oft[i].in.id == EMPTY) {
+			fd = i;
 			break;
 		}
-		else if (fd == NUM_FD - 1) {
-			// OFT is full.
-			errormsg("fs_open: open file table is full\n");
-			return SYSERR;
+		else if (fd == -1 && oft[i].state == FSTATE_CLOSED) {
+			fd = i;
 		}
 	}
+	if (fd == -1) {
+		// OFT is full.
+		errormsg("fs_open: open file table is full\n");
+		return SYSERR;
+	}
 	oft[fd].state = FSTATE_OPEN;
 	oft[fd].fileptr = 0;
-	oft[fd].de = file_dirent;
+	oft[fd].de.inode_num = inode_num;
+	memcpy(oft[fd].de.name, name, FILENAMELEN);
 	oft[fd].flag = flags;
-	if (_fs_get_inode_by_num(dev0, file_dirent->inode_num, &(oft[fd].in)) == SYSERR) {
+	oft[fd].map.indblk = 0;
+	oft[fd].map.goal = 0;
+	if (_fs_get_inode_by_num(dev0, inode_num, &(oft[fd].in)) == SYSERR) {
 		errormsg("fs_open: _fs_get_inode_by_num returned SYSERR\n");
 		return SYSERR;
 	} 
@@ -395,7 +1013,9 @@ int fs_close(int fd) {
 		return SYSERR;
 	}
 
-	// Otherwise, set the state to closed and return OK
+	// Otherwise, save the inode, set the state to closed and return OK
+	_fs_put_inode_by_num(dev0, oft[fd].in.id, &(oft[fd].in));
+	_fs_flush_inodes();
 	(oft[fd]).state = FSTATE_CLOSED;
 	return OK;
 }
@@ -403,71 +1023,30 @@ int fs_close(int fd) {
 int fs_create(char *filename, int mode) {
 	// Validate args quickly
 	if (mode != O_CREAT) {
-		errormsg("Folder creation not supported\n");
+		errormsg("Folder creation not supported (use fs_mkdir)\n");
 		return SYSERR;	
 	}
-	// Make sure root dir isn't full
-	if (fsd.root_dir.numentries >= DIRECTORY_SIZE) {
-		errormsg("Root directory full.\n");
-		return SYSERR;
-	}
-	// make sure filename isn't empty, too long, or already exists
-	if (strncmp(filename, "", FILENAMELEN) == 0) {
-		errormsg("filename can't be empty.\n");
+	// make sure the path is good and the name isn't already in its directory
+	char name[FILENAMELEN + 1];
+	int dir;
+	if ((dir = _fs_path_parent(filename, name)) == SYSERR) {
+		errormsg("fs_create: bad path '%s'\n", filename);
 		return SYSERR;
 	}
-	if (strlen(filename) > FILENAMELEN) {
-		errormsg("filename too long\n");
+	if (_fs_dir_lookup(dir, name, NULL) != SYSERR) {
+		errormsg("File with name '%s' already exists.\n", filename);
 		return SYSERR;
 	}
-	int i;
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		if (fsd.root_dir.entry[i].inode_num != EMPTY && (strncmp(fsd.root_dir.entry[i].name, filename, FILENAMELEN) == 0)) {
-			errormsg("File with name '%s' already exists.\n", filename);
-			return SYSERR;
-		}
-	}
 	
-	/** Determine next available inode number 
-			------------------------------------- **/
-	// Make sure there is an inode available
-	if (fsd.inodes_used >= fsd.ninodes) {
-		errormsg("No more inodes available\n");
-		return SYSERR;
-	}
-	int new_inode_num = fsd.inodes_used;//-1;
-	inode_t tmp_inode;
-/*
-	for (i = 0; i < fsd.ninodes; i++) {
-		// pull the inode's data and check to see if it appears to be in use or not
-		_fs_get_inode_by_num(dev0, i, &tmp_inode);
-		if (tmp_inode.id == EMPTY) {
-			new_inode_num = i;
-			break;
-		}
-	}
-	if (new_inode_num == -1) {
+	// Take a free inode and enter it in the directory
+	int new_inode_num = _fs_new_inode(INODE_TYPE_FILE);
+	if (new_inode_num == SYSERR) {
 		errormsg("fs_create: could not find a free inode\n");
 		return SYSERR;
-	} */
-	fsd.inodes_used++;
-	_fs_get_inode_by_num(dev0, new_inode_num, &tmp_inode);
-	tmp_inode.id = new_inode_num;
-	tmp_inode.type = INODE_TYPE_FILE;
-	tmp_inode.nlink = 1;
-	tmp_inode.device = dev0;
-	tmp_inode.size = 0;
-	_fs_put_inode_by_num(dev0, new_inode_num, &tmp_inode);
-
-	// update directory
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		// find first empty spot in entry array
-		if (fsd.root_dir.entry[i].inode_num == EMPTY) {
-			fsd.root_dir.entry[i].inode_num = new_inode_num;
-			strcpy(fsd.root_dir.entry[i].name, filename);
-			fsd.root_dir.numentries++;
-			break;
-		}
+	}
+	if (_fs_dir_add(dir, name, new_inode_num) == SYSERR) {
+		_fs_free_inode(new_inode_num);
+		return SYSERR;
 	}
 	
 	// Open the new file
@@ -519,18 +1098,30 @@ int fs_read(int fd, void *buf, int nbytes) {
 		return SYSERR;
 	}
 
+	// Don't read past EOF
+	if (nbytes > oft[fd].in.size - oft[fd].fileptr) {
+		nbytes = oft[fd].in.size - oft[fd].fileptr;
+	}
+
 	int bytes_read = 0;
-	int curr_block, curr_offset, curr_len;
-	while (nbytes > 0 && oft[fd].fileptr < oft[fd].in.size) {
+	int curr_block, curr_offset, curr_len, disk_block, nblocks;
+	while (nbytes > 0) {
 		curr_block = oft[fd].fileptr / dev0_blocksize; // Truncated (integer division)
 		curr_offset = oft[fd].fileptr % dev0_blocksize;
 		
-		// Determine how much we can read from this block
-		curr_len = (nbytes <= (dev0_blocksize - curr_offset)) ? nbytes : (dev0_blocksize - curr_offset);
-		if (bs_bread(dev0, oft[fd].in.blocks[curr_block], curr_offset, buf, curr_len) == SYSERR) {
-			errormsg("fs_read: read failed (block: %d, offset: %d, length of read: %d bytes)\n", oft[fd].in.blocks[curr_block], curr_offset, curr_len);
+		// Read as many blocks as sit one after another on the device in one copy
+		nblocks = _fs_extent(&oft[fd].in, &oft[fd].map, curr_block,
+		                     (curr_offset + nbytes + dev0_blocksize - 1) / dev0_blocksize,
+		                     FS_LOOKUP, &disk_block);
+		if (nblocks <= 0) {
+			errormsg("fs_read: read failed (block: %d, offset: %d)\n", curr_block, curr_offset);
 			return SYSERR;
 		}
+		curr_len = nblocks * dev0_blocksize - curr_offset;
+		if (curr_len > nbytes) {
+			curr_len = nbytes;
+		}
+		memcpy(buf, bs_baddr(dev0, disk_block) + curr_offset, curr_len);
 		bytes_read += curr_len;
 		oft[fd].fileptr += curr_len;
 		buf += curr_len;
@@ -562,40 +1153,31 @@ int fs_write(int fd, void *buf, int nbytes) {
 
 	int bytes_written = 0;
 	// Start writing wherever fileptr is
-	// Each inode has INODEDIRECTBLOCKS # of blocks, each of size dev0_blocksize
-	// So then the first block to write to is (fileptr // dev0_blocksize) and offset in that block is (fileptr % dev0_blocksize)
-	// If fileptr has reached INODEDIRECTBLOCKS * dev0_blocksize, then we're out of space in the inode.
-	int curr_block, curr_offset, curr_len;
-	while (nbytes > 0 && oft[fd].fileptr < (INODEDIRECTBLOCKS * dev0_blocksize)) {
+	// The first block to write to is (fileptr // dev0_blocksize) and offset in that block is (fileptr % dev0_blocksize)
+	// If fileptr has reached MAX_FILE_BLOCKS * dev0_blocksize, then we're out of space in the inode.
+	int curr_block, curr_offset, curr_len, disk_block, nblocks;
+	if (nbytes > MAX_FILE_BLOCKS * dev0_blocksize - oft[fd].fileptr) {
+		nbytes = MAX_FILE_BLOCKS * dev0_blocksize - oft[fd].fileptr;
+	}
+	while (nbytes > 0) {
 		curr_block = oft[fd].fileptr / dev0_blocksize; // Truncated (integer division)
 		curr_offset = oft[fd].fileptr % dev0_blocksize;
 
-		// If the current block doesn't exist in the inode yet, then we need to allocate it
-		if (oft[fd].in.blocks[curr_block] == 0) {
-			// Find the first empty block and claim it
-			int i;
-			int new_block_id = -1;
-			for (i = 0; i < fsd.nblocks; i++) {
-				if (!fs_getmaskbit(i)) {
-					new_block_id = i;
-					break;
-				}
-			}
-			if (new_block_id == -1) {
-				break; // Filesystem has no free blocks. Can't continue writing.
-			}
-			else {
-				fs_setmaskbit(new_block_id);
-				oft[fd].in.blocks[curr_block] = new_block_id;
-			}
+		// Look up the blocks, allocating them (and any indirect blocks) if they don't exist yet,
+		// and write the ones that sit one after another on the device in one copy
+		nblocks = _fs_extent(&oft[fd].in, &oft[fd].map, curr_block,
+		                     (curr_offset + nbytes + dev0_blocksize - 1) / dev0_blocksize,
+		                     FS_ALLOC_DATA, &disk_block);
+		if (nblocks <= 0) {
+			break; // Filesystem has no free blocks. Can't continue writing.
 		}
 		
-		// Break off a chunk of the input data that will fit in this block (if necessary)
-		curr_len = (nbytes <= (dev0_blocksize - curr_offset)) ? nbytes : (dev0_blocksize - curr_offset);
-		if (bs_bwrite(dev0, oft[fd].in.blocks[curr_block], curr_offset, buf, curr_len) == SYSERR) {
-			errormsg("fs_write: write failed (block: %d, offset: %d, size of write: %d)\n", oft[fd].in.blocks[curr_block], curr_offset, curr_len);
-			return SYSERR;
+		// Break off the chunk of the input data that fits in those blocks (if necessary)
+		curr_len = nblocks * dev0_blocksize - curr_offset;
+		if (curr_len > nbytes) {
+			curr_len = nbytes;
 		}
+		memcpy(bs_baddr(dev0, disk_block) + curr_offset, buf, curr_len);
 		// update fileptr, buf, bytes_written, and nbytes
 		bytes_written += curr_len;
 		nbytes -= curr_len;
@@ -603,73 +1185,155 @@ int fs_write(int fd, void *buf, int nbytes) {
 		buf += curr_len; // Go forward in the buffer by curr_len bytes
 	}
 
-	// update inode's size
+	// update inode's size and save it (in memory; it reaches the device on close)
 	if (oft[fd].fileptr > oft[fd].in.size) {
 		oft[fd].in.size = oft[fd].fileptr;
 	}
+	_fs_put_inode_by_num(dev0, oft[fd].in.id, &(oft[fd].in));
   return bytes_written;
 }
 
-int fs_link(char *src_filename, char* dst_filename) {
-  // Do some basic argument validation
-	if (src_filename == NULL || dst_filename == NULL) {
-		errormsg("fs_link: filename pointers cannot be NULL\n");
+int fs_fallocate(int fd, int nbytes) {
+	// Validate args the same way fs_write does
+	if (isbadfd(fd)) {
+		errormsg("fs_fallocate: bad fd given\n");
 		return SYSERR;
 	}
-	if ((strncmp(src_filename, "", FILENAMELEN) == 0) || (strncmp(dst_filename, "", FILENAMELEN) == 0)) {
-		errormsg("fs_link: filenames cannot be empty strings\n");
+	if (nbytes < 0) {
+		errormsg("fs_fallocate: nbytes cannot be negative\n");
 		return SYSERR;
 	}
-	if (strnlen(dst_filename, FILENAMELEN+1) > FILENAMELEN) {
-		errormsg("fs_link: destination filename too long\n");
+	if (oft[fd].state != FSTATE_OPEN) {
+		errormsg("fs_fallocate: file is not open\n");
 		return SYSERR;
 	}
-	if (fsd.root_dir.numentries >= DIRECTORY_SIZE) {
-		errormsg("fs_link: root directory is full.\n");
+	if (oft[fd].flag != O_WRONLY && oft[fd].flag != O_RDWR) {
+		errormsg("fs_fallocate: file does not have write-allow flags (is it read-only?)\n");
 		return SYSERR;
 	}
 
-	// Make sure dst_filename isn't already in use somewhere
-	int i;
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		if (strncmp(fsd.root_dir.entry[i].name, dst_filename, FILENAMELEN) == 0) {
-			errormsg("fs_link: destination filename already in use.\n");
-			return SYSERR;
+	int nblocks = (nbytes + dev0_blocksize - 1) / dev0_blocksize;
+	if (nblocks > MAX_FILE_BLOCKS) {
+		errormsg("fs_fallocate: %d bytes is more than a file can hold\n", nbytes);
+		return SYSERR;
+	}
+
+	// Count the blocks the file doesn't have yet
+	int fb, missing = 0;
+	for (fb = 0; fb < nblocks; fb++) {
+		if (_fs_map_block(&oft[fd].in, &oft[fd].map, fb, FS_LOOKUP) == 0) {
+			missing++;
 		}
 	}
+	if (missing == 0) {
+		return OK;
+	}
 
-	// Find the source file in the root directory
-	int source_file_index = -1;
-	int source_file_inode = EMPTY;
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		if (strncmp(fsd.root_dir.entry[i].name, src_filename, FILENAMELEN) == 0) {
-			source_file_index = i;
-			source_file_inode = fsd.root_dir.entry[i].inode_num;
-			break;
+	// Start them at a free run big enough for the data and its indirect blocks, if there is one,
+	// with the indirect blocks at the front so the data is in one piece
+	int run = _fs_find_run(missing + missing / PTRS_PER_BLOCK + 2);
+	if (run != SYSERR) {
+		oft[fd].map.goal = run;
+		for (fb = INODEDIRECTBLOCKS; fb < nblocks; fb += PTRS_PER_BLOCK) {
+			if (_fs_map_block(&oft[fd].in, &oft[fd].map, fb, FS_ALLOC_MAP) == SYSERR) {
+				break;
+			}
 		}
-	}	
-	if (source_file_index == -1 || source_file_inode == EMPTY) {
-		errormsg("fs_link: could not find source filename in root dir\n");
-		return SYSERR;
 	}
-	
-	// Grab the first free dirent for the new link (filename)
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		// This could be safer (make sure we find an empty one), but we guarantee there's at least one
-		// free dirent above.
-		if (fsd.root_dir.entry[i].inode_num == EMPTY) {
-			fsd.root_dir.entry[i].inode_num = source_file_inode;
-			strcpy(fsd.root_dir.entry[i].name, dst_filename);
-			fsd.root_dir.numentries++;
+	for (fb = 0; fb < nblocks; fb++) {
+		if (_fs_map_block(&oft[fd].in, &oft[fd].map, fb, FS_ALLOC_DATA) == SYSERR) {
+			errormsg("fs_fallocate: out of space at file block %d\n", fb);
 			break;
 		}
 	}
+	_fs_put_inode_by_num(dev0, oft[fd].in.id, &(oft[fd].in));
+	return (fb == nblocks) ? OK : SYSERR;
+}
+
+int fs_map(int fd, int offset, int len, void **ptr) {
+	// Validate args the same way fs_read does
+	if (isbadfd(fd)) {
+		errormsg("fs_map: bad fd given\n");
+		return SYSERR;
+	}
+	if (len < 0 || ptr == NULL) {
+		errormsg("fs_map: bad length or NULL pointer given\n");
+		return SYSERR;
+	}
+	if (oft[fd].state != FSTATE_OPEN) {
+		errormsg("fs_map: file is not open\n");
+		return SYSERR;
+	}
+	if (offset < 0 || offset > oft[fd].in.size) {
+		errormsg("fs_map: offset %d is outside the file\n", offset);
+		return SYSERR;
+	}
+
+	// Nothing to map at EOF
+	if (len > oft[fd].in.size - offset) {
+		len = oft[fd].in.size - offset;
+	}
+	if (len == 0) {
+		return 0;
+	}
 
-	// Update the inode's nlink field
+	int curr_offset = offset % dev0_blocksize;
+	int disk_block;
+	int nblocks = _fs_extent(&oft[fd].in, &oft[fd].map, offset / dev0_blocksize,
+	                         (curr_offset + len + dev0_blocksize - 1) / dev0_blocksize,
+	                         FS_LOOKUP, &disk_block);
+	if (nblocks <= 0) {
+		errormsg("fs_map: no block at offset %d\n", offset);
+		return SYSERR;
+	}
+	*ptr = bs_baddr(dev0, disk_block) + curr_offset;
+	return (nblocks * dev0_blocksize - curr_offset < len) ? nblocks * dev0_blocksize - curr_offset : len;
+}
+
+int fs_link(char *src_filename, char* dst_filename) {
+  // Do some basic argument validation
+	if (src_filename == NULL || dst_filename == NULL) {
+		errormsg("fs_link: filename pointers cannot be NULL\n");
+		return SYSERR;
+	}
+
+	// Find the source file; directories can't be linked
+	int source_file_inode = _fs_path_lookup(src_filename);
+	if (source_file_inode == SYSERR) {
+		errormsg("fs_link: could not find source file\n");
+		return SYSERR;
+	}
+	if (inode_cache[source_file_inode].type != INODE_TYPE_FILE) {
+		errormsg("fs_link: source is a directory\n");
+		return SYSERR;
+	}
+
+	// Make sure dst_filename isn't already in use in its directory
+	char name[FILENAMELEN + 1];
+	int dir = _fs_path_parent(dst_filename, name);
+	if (dir == SYSERR) {
+		errormsg("fs_link: bad destination path\n");
+		return SYSERR;
+	}
+	if (_fs_dir_lookup(dir, name, NULL) != SYSERR) {
+		errormsg("fs_link: destination filename already in use.\n");
+		return SYSERR;
+	}
+	if (_fs_dir_add(dir, name, source_file_inode) == SYSERR) {
+		return SYSERR;
+	}
+
+	// Update the inode's nlink field, and the copy of any open file table entry for it
+	int i;
 	inode_t temp_inode;
 	_fs_get_inode_by_num(dev0, source_file_inode, &temp_inode);
 	temp_inode.nlink++;
 	_fs_put_inode_by_num(dev0, source_file_inode, &temp_inode);
+	for (i = 0; i < NUM_FD; i++) {
+		if (oft[i].in.id == source_file_inode) {
+			oft[i].in.nlink = temp_inode.nlink;
+		}
+	}
 
 	return OK;
 }
@@ -680,49 +1344,94 @@ int fs_unlink(char *filename) {
 		errormsg("fs_unlink: filename pointers cannot be NULL\n");
 		return SYSERR;
 	}
-	if (strncmp(filename, "", FILENAMELEN) == 0) {
-		errormsg("fs_unlink: filenames cannot be empty strings\n");
-		return SYSERR;
-	}
-	if (fsd.root_dir.numentries == 0) {
-		errormsg("fs_unlink: root directory is empty...\n");
+	
+	// Find the file in its directory
+	char name[FILENAMELEN + 1];
+	int dir, file_inode;
+	if ((dir = _fs_path_parent(filename, name)) == SYSERR
+	    || (file_inode = _fs_dir_lookup(dir, name, NULL)) == SYSERR) {
+		errormsg("fs_unlink: could not find file\n");
 		return SYSERR;
 	}
-	
-	// Find the source file in the root directory
-	int file_index = -1;
-	int file_inode = EMPTY;
-	int i;
-	for (i = 0; i < DIRECTORY_SIZE; i++) {
-		if (strncmp(fsd.root_dir.entry[i].name, filename, FILENAMELEN) == 0) {
-			file_index = i;
-			file_inode = fsd.root_dir.entry[i].inode_num;
-			break;
-		}
-	}	
-	if (file_index == -1 || file_inode == EMPTY) {
-		errormsg("fs_unlink: could not find filename in root dir\n");
+	if (inode_cache[file_inode].type != INODE_TYPE_FILE) {
+		errormsg("fs_unlink: %s is a directory\n", name);
 		return SYSERR;
 	}
 
-	// Delete the directory entry and decrement numentries
-	fsd.root_dir.entry[file_index].inode_num = EMPTY;
-	memset(fsd.root_dir.entry[file_index].name, 0, FILENAMELEN);
-	fsd.root_dir.numentries--;
+	// Delete the directory entry
+	_fs_dir_remove(dir, name);
 
 	// Decrement the inode's nlink field. If this was the only link, free up the inode
+	int i;
 	inode_t temp_inode;
 	_fs_get_inode_by_num(dev0, file_inode, &temp_inode);
 	temp_inode.nlink--;
+	_fs_put_inode_by_num(dev0, file_inode, &temp_inode);
 	if (temp_inode.nlink == 0) {
 		// It's now empty. Pack it up, boys.
-		temp_inode.id = EMPTY;
-		temp_inode.size = 0;
-		fsd.inodes_used--;
+		_fs_free_inode(file_inode);
+	}
+	for (i = 0; i < NUM_FD; i++) {
+		if (oft[i].in.id == file_inode) {
+			oft[i].in.nlink = temp_inode.nlink;
+			if (temp_inode.nlink == 0) {
+				// The file is gone; its descriptor is no longer valid
+				oft[i].in.id = EMPTY;
+				oft[i].state = FSTATE_CLOSED;
+			}
+		}
 	}
-	_fs_put_inode_by_num(dev0, file_inode, &temp_inode);
   return OK;
 }
 
+int fs_mkdir(char *dirname) {
+	char name[FILENAMELEN + 1];
+	int dir, new_inode_num;
+
+	if ((dir = _fs_path_parent(dirname, name)) == SYSERR) {
+		errormsg("fs_mkdir: bad path\n");
+		return SYSERR;
+	}
+	if (_fs_dir_lookup(dir, name, NULL) != SYSERR) {
+		errormsg("fs_mkdir: '%s' already exists\n", dirname);
+		return SYSERR;
+	}
+	if ((new_inode_num = _fs_new_inode(INODE_TYPE_DIR)) == SYSERR) {
+		return SYSERR;
+	}
+	if (_fs_dir_add(dir, name, new_inode_num) == SYSERR) {
+		_fs_free_inode(new_inode_num);
+		return SYSERR;
+	}
+	return OK;
+}
+
+int fs_readdir(char *dirname, int *pos, dirent_t *de) {
+	struct dirindex *di;
+	int dir;
+
+	if (pos == NULL || de == NULL || *pos < 0) {
+		errormsg("fs_readdir: bad arguments\n");
+		return SYSERR;
+	}
+	dir = _fs_path_lookup(dirname);
+	if (dir == SYSERR || inode_cache[dir].type != INODE_TYPE_DIR) {
+		errormsg("fs_readdir: no such directory\n");
+		return SYSERR;
+	}
+	if ((di = _fs_dir(dir)) == NULL) {
+		return SYSERR;
+	}
+
+	// Skip the free slots
+	while (*pos < di->nslots) {
+		_fs_dirent_io(dir, (*pos)++, de, 0);
+		if (de->inode_num != EMPTY) {
+			return OK;
+		}
+	}
+	return EOF;
+}
+
 #endif /* FS */
 
@@ -8,9 +8,52 @@
 #include <xinu.h>
 #include <future.h>
 
+#define FUTURE_FOREVER (-1) // maxwait for waits that never time out
+
+// Block the current process on one of a future's wait queues, or on none
+// if q is EMPTY (interrupts must already be disabled). With maxwait >= 0 a
+// timer on the sleep wheel takes the process back off the queue after
+// that many ms. Returns OK once woken, TIMEOUT, or SYSERR.
+static syscall future_block(qid16 q, int32 maxwait) {
+	struct procent *prptr = &proctab[currpid];
+
+	if (maxwait == 0) {
+		return TIMEOUT;
+	}
+	if (q != EMPTY && enqueue(currpid, q) == SYSERR) {
+		return SYSERR;
+	}
+	prptr->prstate = PR_FWAIT;
+	if (maxwait > 0) {
+		prptr->prwaitq = q;
+		prptr->prtimeout = FALSE;
+		tmenqueue(currpid, tmnow + maxwait);
+	}
+	resched();
+	if (maxwait > 0 && prptr->prtimeout) {
+		return TIMEOUT;
+	}
+	return OK;
+}
+
+// Wake the first process waiting on a future's queue, if there is one.
+static syscall future_wake(qid16 q) {
+	pid32 pid;
+	if (isempty(q)) {
+		return OK;
+	}
+	pid = dequeue(q);
+	if (pid == SYSERR || isbadpid(pid)) {
+		return SYSERR;
+	}
+	return ready(pid);
+}
+
+static syscall future_get_wait(future_t* f, char* out, int32 maxwait);
+
 future_t* future_alloc(future_mode_t mode, uint size, uint nelems) {
 	// Allocate space for a future
-	future_t* new_future = (future_t *) getmem(sizeof(future_t));
+	future_t* new_future = (future_t *) getslab(sizeof(future_t));
 	if (new_future == (future_t *)SYSERR) {
 		return (future_t *)SYSERR;
 	}
@@ -22,7 +65,7 @@ future_t* future_alloc(future_mode_t mode, uint size, uint nelems) {
 	new_future->max_elems = nelems;
 
 	// Allocate `size` amount of space for the data (array of size `nelems`)
-	new_future->data = getmem(size * nelems);
+	new_future->data = getslab(size * nelems);
 	if (new_future->data == (char *)SYSERR) {
 		return (future_t *)SYSERR;
 	}
@@ -46,6 +89,8 @@ future_t* future_alloc(future_mode_t mode, uint size, uint nelems) {
 		new_future->count = 0;
 		new_future->head = 0;
 		new_future->tail = 0;
+		new_future->reserved = 0;
+		new_future->peeked = 0;
 	}
 	
 	return new_future;
@@ -91,14 +136,14 @@ syscall future_free(future_t* f) {
 				status = SYSERR;
 			}
 		}
-		if (delqueue(f->get_queue) == SYSERR) {
+		if (delqueue(f->set_queue) == SYSERR) {
 			status = SYSERR;
 		}
 	}
-	if (freemem(f->data, f->size * f->max_elems) == SYSERR) {
+	if (freeslab(f->data, f->size * f->max_elems) == SYSERR) {
 		status = SYSERR;
 	}
-	if (freemem((char *) f, sizeof(future_t)) == SYSERR) {
+	if (freeslab((char *) f, sizeof(future_t)) == SYSERR) {
 		status = SYSERR;
 	}
 	
@@ -107,18 +152,39 @@ syscall future_free(future_t* f) {
 }
 
 syscall future_get(future_t* f, char* out) {
+	return future_get_wait(f, out, FUTURE_FOREVER);
+}
+
+// Like future_get, but give up and return TIMEOUT if no value arrives
+// within maxwait ms (0 only polls).
+syscall future_get_timeout(future_t* f, char* out, int32 maxwait) {
+	if (maxwait < 0) {
+		return SYSERR;
+	}
+	return future_get_wait(f, out, maxwait);
+}
+
+static syscall future_get_wait(future_t* f, char* out, int32 maxwait) {
 	intmask mask = disable();
+	syscall status;
+	trace(TR_FGET, f, f->mode);
 	if (f->mode == FUTURE_EXCLUSIVE) {
 		if (f->state == FUTURE_EMPTY) {
-			// Need to block until the data is ready.
-			struct procent *proc_ptr = &proctab[currpid];
-
-			// Save the PID in the future struct and set the state to WAITING
+			// Save the PID in the future struct and set the state to WAITING,
+			// then block until the data is ready.
 			f->pid = currpid;
 			f->state = FUTURE_WAITING;
 
-			proc_ptr->prstate = PR_FWAIT;
-			resched();
+			status = future_block(EMPTY, maxwait);
+			if (status != OK) {
+				// Nobody is waiting any more.  A value set after the timer
+				// fired but before we ran stays for the next get.
+				if (f->state == FUTURE_WAITING) {
+					f->state = FUTURE_EMPTY;
+				}
+				restore(mask);
+				return status;
+			}
 
 			// Copy the data
 			memcpy((void *) out, (void *) f->data, f->size);
@@ -148,17 +214,17 @@ syscall future_get(future_t* f, char* out) {
 			return OK;
 		}
 		else {
-			struct procent *proc_ptr = &proctab[currpid];
-
 			// Enqueue this processes's PID and update the status to WAITING,
 			// then block until the data is written
-			if (enqueue(currpid, f->get_queue) == SYSERR) {
+			f->state = FUTURE_WAITING;
+			status = future_block(f->get_queue, maxwait);
+			if (status != OK) {
+				if (isempty(f->get_queue) && f->state == FUTURE_WAITING) {
+					f->state = FUTURE_EMPTY;
+				}
 				restore(mask);
-				return SYSERR;
+				return status;
 			}
-			f->state = FUTURE_WAITING;
-			proc_ptr->prstate = PR_FWAIT;
-			resched();
 
 			// Copy data out
 			memcpy((void *) out, (void *) f->data, f->size);
@@ -167,15 +233,18 @@ syscall future_get(future_t* f, char* out) {
 		}
 	}
 	else if (f->mode == FUTURE_QUEUE) {
-		if (f->count <= 0) {	
+		if (f->peeked > 0) {
+			// Borrowed slots sit at the tail; a copy would skip past them
+			restore(mask);
+			return SYSERR;
+		}
+		if (f->count <= 0) {
 			// Queue is empty. Need to wait.
-			struct procent *proc_ptr = &proctab[currpid];
-			if (enqueue(currpid, f->get_queue) == SYSERR) {
+			status = future_block(f->get_queue, maxwait);
+			if (status != OK) {
 				restore(mask);
-				return SYSERR;
+				return status;
 			}
-			proc_ptr->prstate = PR_FWAIT;
-			resched();
 		}
 		// Copy data out
 		memcpy((void *) out, (void *)(f->data + (f->tail * f->size)), f->size);
@@ -183,16 +252,9 @@ syscall future_get(future_t* f, char* out) {
 		f->tail = (f->tail + 1) % f->max_elems;
 
 		// Wake up a waiting writer, if any
-		if (!isempty(f->set_queue)) {
-			pid32 pid = dequeue(f->set_queue);
-			if (pid == SYSERR || isbadpid(pid)) {
-				restore(mask);
-				return SYSERR;
-			}
-			ready(pid);
-		}
+		status = future_wake(f->set_queue);
 		restore(mask);
-		return OK;
+		return status;
 	}
 	restore(mask);
 	return SYSERR;
@@ -200,6 +262,7 @@ syscall future_get(future_t* f, char* out) {
 
 syscall future_set(future_t* f, char* in) {
 	intmask mask = disable();
+	trace(TR_FSET, f, f->mode);
 
 	if (f->mode == FUTURE_EXCLUSIVE || f->mode == FUTURE_SHARED) {
 		if (f->state == FUTURE_READY) {
@@ -222,7 +285,11 @@ syscall future_set(future_t* f, char* in) {
 					restore(mask);
 					return SYSERR;
 				}
-				ready(f->pid);
+				// A getter whose timeout already fired is ready and will
+				// return TIMEOUT; the value stays READY
+				if (proctab[f->pid].prstate == PR_FWAIT) {
+					ready(f->pid);
+				}
 			}
 			else if (f->mode == FUTURE_SHARED) {
 				pid32 pid;
@@ -240,6 +307,11 @@ syscall future_set(future_t* f, char* in) {
 		}
 	}
 	else if (f->mode == FUTURE_QUEUE) {
+		if (f->reserved > 0) {
+			// Reserved slots sit at the head; a copy would land behind them
+			restore(mask);
+			return SYSERR;
+		}
 		// If there's no space to write, need to wait
 		if (data_queue_full(f)) {
 			struct procent *proc_ptr = &proctab[currpid];
@@ -271,3 +343,180 @@ syscall future_set(future_t* f, char* in) {
 	restore(mask);
 	return SYSERR;
 }
+
+// Hand the producer a pointer to the next free slot of a FUTURE_QUEUE so it
+// can be filled in place. The slot is invisible to consumers until
+// future_commit; commits publish reservations in the order they were made.
+char* future_reserve(future_t* f) {
+	intmask mask = disable();
+	char* slot;
+
+	if (f->mode != FUTURE_QUEUE) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	while (data_queue_full(f)) {
+		if (future_block(f->set_queue, FUTURE_FOREVER) == SYSERR) {
+			restore(mask);
+			return (char *)SYSERR;
+		}
+	}
+	slot = f->data + (((f->head + f->reserved) % f->max_elems) * f->size);
+	f->reserved++;
+	restore(mask);
+	return slot;
+}
+
+// Publish the oldest reserved slot and wake a waiting consumer, if any.
+syscall future_commit(future_t* f) {
+	intmask mask = disable();
+	syscall status;
+
+	if (f->mode != FUTURE_QUEUE || f->reserved == 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	f->reserved--;
+	f->count++;
+	f->head = (f->head + 1) % f->max_elems;
+	status = future_wake(f->get_queue);
+	restore(mask);
+	return status;
+}
+
+// Hand the consumer a pointer to the oldest unread element of a FUTURE_QUEUE,
+// blocking until one is available. The slot stays valid (and cannot be
+// overwritten) until future_release.
+char* future_peek(future_t* f) {
+	intmask mask = disable();
+	char* slot;
+
+	if (f->mode != FUTURE_QUEUE) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+	while (f->count <= f->peeked) {
+		if (future_block(f->get_queue, FUTURE_FOREVER) == SYSERR) {
+			restore(mask);
+			return (char *)SYSERR;
+		}
+	}
+	slot = f->data + (((f->tail + f->peeked) % f->max_elems) * f->size);
+	f->peeked++;
+	restore(mask);
+	return slot;
+}
+
+// Give the oldest peeked slot back to the queue and wake a waiting producer.
+syscall future_release(future_t* f) {
+	intmask mask = disable();
+	syscall status;
+
+	if (f->mode != FUTURE_QUEUE || f->peeked == 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	f->peeked--;
+	f->count--;
+	f->tail = (f->tail + 1) % f->max_elems;
+	status = future_wake(f->set_queue);
+	restore(mask);
+	return status;
+}
+
+// Copy n elements into the ring starting at its head (or out of it starting
+// at its tail), splitting the copy where the ring wraps around.
+static void future_copy_in(future_t* f, char* in, uint32 n) {
+	uint32 first = f->max_elems - f->head;
+	if (first > n) {
+		first = n;
+	}
+	memcpy((void *)(f->data + (f->head * f->size)), (void *) in, first * f->size);
+	memcpy((void *) f->data, (void *)(in + (first * f->size)), (n - first) * f->size);
+	f->head = (f->head + n) % f->max_elems;
+	f->count += n;
+}
+
+static void future_copy_out(future_t* f, char* out, uint32 n) {
+	uint32 first = f->max_elems - f->tail;
+	if (first > n) {
+		first = n;
+	}
+	memcpy((void *) out, (void *)(f->data + (f->tail * f->size)), first * f->size);
+	memcpy((void *)(out + (first * f->size)), (void *) f->data, (n - first) * f->size);
+	f->tail = (f->tail + n) % f->max_elems;
+	f->count -= n;
+}
+
+// Wake up to n processes waiting on a future's queue with a single
+// reschedule at the end.
+static syscall future_wake_n(qid16 q, uint32 n) {
+	syscall status = OK;
+	resched_cntl(DEFER_START);
+	while (n-- > 0 && !isempty(q)) {
+		if (future_wake(q) == SYSERR) {
+			status = SYSERR;
+			break;
+		}
+	}
+	resched_cntl(DEFER_STOP);
+	return status;
+}
+
+// Write up to n elements from `in` to a FUTURE_QUEUE in one critical section,
+// blocking only while the queue is completely full.
+int32 future_set_n(future_t* f, char* in, uint32 n) {
+	intmask mask = disable();
+	uint32 space;
+
+	if (f->mode != FUTURE_QUEUE || f->reserved > 0 || n == 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	while (data_queue_full(f)) {
+		if (future_block(f->set_queue, FUTURE_FOREVER) == SYSERR) {
+			restore(mask);
+			return SYSERR;
+		}
+	}
+	space = f->max_elems - f->count;
+	if (n > space) {
+		n = space;
+	}
+	trace(TR_FSET, f, n);
+	future_copy_in(f, in, n);
+	if (future_wake_n(f->get_queue, n) == SYSERR) {
+		restore(mask);
+		return SYSERR;
+	}
+	restore(mask);
+	return n;
+}
+
+// Read up to n elements from a FUTURE_QUEUE into `out` in one critical
+// section, blocking only while the queue is empty.
+int32 future_get_n(future_t* f, char* out, uint32 n) {
+	intmask mask = disable();
+
+	if (f->mode != FUTURE_QUEUE || f->peeked > 0 || n == 0) {
+		restore(mask);
+		return SYSERR;
+	}
+	while (f->count == 0) {
+		if (future_block(f->get_queue, FUTURE_FOREVER) == SYSERR) {
+			restore(mask);
+			return SYSERR;
+		}
+	}
+	if (n > f->count) {
+		n = f->count;
+	}
+	trace(TR_FGET, f, n);
+	future_copy_out(f, out, n);
+	if (future_wake_n(f->set_queue, n) == SYSERR) {
+		restore(mask);
+		return SYSERR;
+	}
+	restore(mask);
+	return n;
+}
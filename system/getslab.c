@@ -0,0 +1,152 @@
+/* getslab.c - getslab, slabnewpage */
+
+#include <xinu.h>
+
+local	struct	slabpage *slabnewpage(int32);
+
+/*------------------------------------------------------------------------
+ *  getslab  -  Allocate an object from the smallest size class that
+ *		  fits, falling back to getmem for large requests
+ *------------------------------------------------------------------------
+ */
+char  	*getslab(
+	  uint32	nbytes		/* Size of memory requested	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	cls;			/* Index of size class		*/
+	struct	slabclass *scptr;	/* Pointer to entry in slabtab	*/
+	struct	slabpage *pgptr;	/* Page that supplies the object*/
+	struct	slabobj	*obj;		/* Object being allocated	*/
+
+	mask = disable();
+	if (nbytes == 0) {
+		restore(mask);
+		return (char *)SYSERR;
+	}
+
+	cls = slabindex(nbytes);
+	if (cls == SYSERR) {		/* Too large for any class	*/
+		restore(mask);
+		return getmem(nbytes);
+	}
+	scptr = &slabtab[cls];
+
+	/* Use the first page with a free object, or carve a new one	*/
+
+	pgptr = scptr->scpages;
+	if (pgptr == NULL) {
+		pgptr = slabnewpage(cls);
+		if (pgptr == (struct slabpage *)SYSERR) {
+			restore(mask);
+			return (char *)SYSERR;
+		}
+	} else {
+		scptr->schits++;
+	}
+
+	obj = pgptr->spfree;
+	pgptr->spfree = obj->sonext;
+	if (pgptr->spinuse++ == 0) {
+		scptr->scempty--;
+	}
+
+	/* A full page leaves the list of pages with free objects	*/
+
+	if (pgptr->spfree == NULL) {
+		scptr->scpages = pgptr->spnext;
+		if (scptr->scpages != NULL) {
+			scptr->scpages->spprev = NULL;
+		}
+	}
+	scptr->scinuse++;
+	scptr->scallocs++;
+	restore(mask);
+	return (char *)obj;
+}
+
+/*------------------------------------------------------------------------
+ *  slabnewpage  -  Carve an aligned page for a size class out of the
+ *		      free memory list and link its objects together
+ *------------------------------------------------------------------------
+ */
+local	struct	slabpage *slabnewpage(	/* Assumes interrupts disabled	*/
+	  int32		cls		/* Index of size class		*/
+	)
+{
+	struct	slabclass *scptr;	/* Pointer to entry in slabtab	*/
+	struct	memblk	*prev, *curr;	/* Walk through memory list	*/
+	struct	memblk	*next, *leftover;
+	struct	slabpage *pgptr;	/* New page			*/
+	struct	slabobj	*obj;		/* Walks objects in the page	*/
+	uint32	pagesz;			/* Size (and alignment) of page	*/
+	uint32	start, end;		/* Page start and end of block	*/
+	uint32	i;
+
+	scptr = &slabtab[cls];
+	pagesz = scptr->scpagesz;
+
+	/* Find the first free block that contains an aligned page	*/
+
+	prev = &memlist;
+	curr = memlist.mnext;
+	start = end = 0;
+	while (curr != NULL) {
+		start = ((uint32)curr + pagesz - 1) & ~(pagesz - 1);
+		end = (uint32)curr + curr->mlength;
+		if ((start >= (uint32)curr) && (start < end)
+					    && (end - start >= pagesz)) {
+			break;
+		}
+		prev = curr;
+		curr = curr->mnext;
+	}
+	if (curr == NULL) {
+		return (struct slabpage *)SYSERR;
+	}
+
+	/* Return the part of the block above the page to the list	*/
+
+	next = curr->mnext;
+	if (end - start > pagesz) {
+		leftover = (struct memblk *)(start + pagesz);
+		leftover->mnext = next;
+		leftover->mlength = end - (start + pagesz);
+		next = leftover;
+	}
+
+	/* Keep the part of the block below the page, if any		*/
+
+	if (start > (uint32)curr) {
+		curr->mlength = start - (uint32)curr;
+		curr->mnext = next;
+	} else {
+		prev->mnext = next;
+	}
+	memlist.mlength -= pagesz;
+
+	/* Initialize the page header and thread the free objects	*/
+
+	pgptr = (struct slabpage *)start;
+	pgptr->spclass = cls;
+	pgptr->spinuse = 0;
+	obj = (struct slabobj *)roundmb(start + sizeof(struct slabpage));
+	pgptr->spfree = obj;
+	for (i = 1; i < scptr->scperpage; i++) {
+		obj->sonext = (struct slabobj *)((char *)obj + scptr->scsize);
+		obj = obj->sonext;
+	}
+	obj->sonext = NULL;
+
+	/* Place the page at the front of the class' page list	*/
+
+	pgptr->spprev = NULL;
+	pgptr->spnext = scptr->scpages;
+	if (scptr->scpages != NULL) {
+		scptr->scpages->spprev = pgptr;
+	}
+	scptr->scpages = pgptr;
+	scptr->scnpages++;
+	scptr->scempty++;
+	return pgptr;
+}
@@ -0,0 +1,83 @@
+/* gettime_ns.c - cycinit, cycles2ns, gettime_ns, udiv64 */
+
+#include <xinu.h>
+
+uint32	clkcyckhz;			/* Cycle counter rate in kHz	*/
+uint32	clkcycmult;			/* ns per cycle << CLKCYCSHIFT	*/
+uint64	clkcycboot;			/* Cycle count at boot		*/
+
+/*------------------------------------------------------------------------
+ *  cycinit  -  Record the rate of the cycle counter (called by clkinit
+ *		  once the rate has been measured or is known)
+ *------------------------------------------------------------------------
+ */
+void	cycinit(
+	  uint32	khz		/* Cycles per millisecond	*/
+	)
+{
+	if (khz == 0) {
+		khz = 1;
+	}
+	clkcycboot = getcycles();
+	clkcyckhz = khz;
+	clkcycmult = (uint32)udiv64((uint64)1000000 << CLKCYCSHIFT, khz,
+								NULL);
+}
+
+/*------------------------------------------------------------------------
+ *  cycles2ns  -  Convert a count of cycles to nanoseconds
+ *------------------------------------------------------------------------
+ */
+uint64	cycles2ns(
+	  uint64	cycles		/* Count of cycles		*/
+	)
+{
+	uint64	lo, hi;			/* Products of the two halves	*/
+
+	/* Multiply each 32-bit half by the scale factor separately so	*/
+	/*   the intermediate products cannot overflow 64 bits		*/
+
+	lo = ((uint64)(uint32)cycles * clkcycmult) >> CLKCYCSHIFT;
+	hi = ((uint64)(uint32)(cycles >> 32) * clkcycmult)
+						<< (32 - CLKCYCSHIFT);
+	return hi + lo;
+}
+
+/*------------------------------------------------------------------------
+ *  gettime_ns  -  Return nanoseconds since the clock was initialized
+ *------------------------------------------------------------------------
+ */
+uint64	gettime_ns(void)
+{
+	return cycles2ns(getcycles() - clkcycboot);
+}
+
+/*------------------------------------------------------------------------
+ *  udiv64  -  Divide a 64-bit value by a 32-bit value without help
+ *		 from the compiler's run-time library
+ *------------------------------------------------------------------------
+ */
+uint64	udiv64(
+	  uint64	num,		/* Dividend			*/
+	  uint32	den,		/* Divisor (nonzero)		*/
+	  uint32	*rem		/* Remainder, or NULL		*/
+	)
+{
+	uint64	quot;			/* Quotient being built		*/
+	uint64	r;			/* Partial remainder		*/
+	int32	i;			/* Bit of the dividend		*/
+
+	quot = 0;
+	r = 0;
+	for (i = 63; i >= 0; i--) {
+		r = (r << 1) | ((num >> i) & 1);
+		if (r >= den) {
+			r -= den;
+			quot |= (uint64)1 << i;
+		}
+	}
+	if (rem != NULL) {
+		*rem = (uint32)r;
+	}
+	return quot;
+}
@@ -12,7 +12,7 @@ extern	void	*_end;		/* End of Xinu code			*/
 
 extern	void main(void);	/* Main is the first process created	*/
 static	void sysinit(); 	/* Internal system initialization	*/
-extern	void heartbeat(); 	/* Internal hearbeat initialization	*/
+extern	void heartbeat(void *);	/* Heartbeat LED callout		*/
 extern	void meminit(void);	/* Initializes the free memory list	*/
 local	process startup(void);	/* Process to finish startup tasks	*/
 
@@ -105,10 +105,9 @@ void	nulluser()
 #endif
 
 #ifdef GPIO
-	/* Create a heartbeat status process (LED blinker) */
+	/* Start the heartbeat status callout (LED blinker) */
 
-	resume(create((void*)heartbeat, INITSTK, INITPRIO,
-		                        "Heartbeat process", 0, NULL));
+	timer_add(heartbeat, (void *)0, 1);
 #endif
 	
 	/* Create a process to finish startup and start main */
@@ -120,7 +119,15 @@ void	nulluser()
 	/*  something to run when no other process is ready to execute)	*/
 
 	while (TRUE) {
-		;		/* Do nothing */
+
+		/* Halt until the next interrupt; with tickless idle	*/
+		/*   that is the next timer expiry			*/
+
+#if defined(X86_QEMU) || defined(X86_GALILEO)
+		asm volatile ("hlt");
+#elif defined(ARM_QEMU)
+		asm volatile ("mcr p15, 0, %0, c7, c0, 4" : : "r" (0));
+#endif
 	}
 
 }
@@ -258,9 +265,14 @@ static	void	sysinit()
 
 	bufinit();
 
+	/* Initialize the size classes of the slab allocator */
+
+	slabinit();
+
 	/* Create a ready list for processes */
 
 	readylist = newqueue();
+	rqinit();
 
 	if (ptinit(PTMAXMSG) == SYSERR) {
 		kprintf("ptinit failed\n");
@@ -44,10 +44,18 @@ syscall	kill(
 
 	case PR_WAIT:
 		semtab[prptr->prsem].scount++;
-		/* Fall through */
+		getitem(pid);		/* Remove from semaphore queue */
+		tmdequeue(pid);		/* Cancel waittime's timer */
+		prptr->prstate = PR_FREE;
+		break;
+
+	case PR_FWAIT:
+		tmdequeue(pid);		/* Cancel future_get_timeout's timer */
+		prptr->prstate = PR_FREE;
+		break;
 
 	case PR_READY:
-		getitem(pid);		/* Remove from queue */
+		rqremove(pid);		/* Remove from ready list */
 		/* Fall through */
 
 	default:
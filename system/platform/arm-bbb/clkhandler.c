@@ -1,4 +1,4 @@
-/* clkhandler.c - clkhandler */
+/* clkhandler.c - clkhandler, clkresume */
 
 #include <xinu.h>
 
@@ -22,6 +22,7 @@ void	clkhandler()
 	/* Acknowledge the interrupt */
 
 	csrptr->tisr = AM335X_TIMER1MS_TISR_OVF_IT_FLAG;
+	clkintr++;
 
 	/* Increment 1000ms counter */
 
@@ -34,18 +35,10 @@ void	clkhandler()
 		clkticks = 0;
 	}
 	
-	/* check if sleep queue is empty */
+	/* Advance the timing wheel: wake sleeping processes */
+	/*   and run callouts that are due			*/
 
-	if(!isempty(sleepq)) {
-
-		/* sleepq nonempty, decrement the key of */
-		/* topmost process on sleepq		 */
-
-		if((--queuetab[firstid(sleepq)].qkey) == 0) {
-
-			wakeup();
-		}
-	}
+	wakeup();
 
 	/* Decrement the preemption counter */
 	/* Reschedule if necessary	    */
@@ -55,3 +48,12 @@ void	clkhandler()
 		resched();
 	}
 }
+
+/*-----------------------------------------------------------------------
+ * clkresume - Leave tickless idle (the 1 ms timer here always runs)
+ *-----------------------------------------------------------------------
+ */
+void	clkresume(void)
+{
+	clkidle = FALSE;
+}
@@ -4,11 +4,13 @@
 
 uint32	clktime;		/* Seconds since boot			*/
 uint32	ctr1000 = 0;		/* Milliseconds since boot		*/
-qid16	sleepq;			/* Queue of sleeping processes		*/
 uint32	preempt;		/* Preemption counter			*/
 volatile ulong clkticks;
+bool8	clktickless = FALSE;	/* Tickless idle is not supported	*/
+bool8	clkidle = FALSE;	/* In a tickless one-shot		*/
+uint32	clkintr = 0;		/* Clock interrupts since boot		*/
 /*------------------------------------------------------------------------
- * clkinit  -  Initialize the clock and sleep queue at startup
+ * clkinit  -  Initialize the clock and timing wheel at startup
  *------------------------------------------------------------------------
  */
 void	clkinit(void)
@@ -35,8 +37,8 @@ void	clkinit(void)
 
 	set_evec(AM335X_TIMER1MS_IRQ, (uint32)clkhandler);
 
-	sleepq = newqueue();	/* Allocate a queue to hold the delta	*/
-				/*   list of sleeping processes		*/
+	timerinit();		/* Initialize the timing wheel for	*/
+				/*   sleeping processes			*/
 
 	preempt = QUANTUM;	/* Set the preemption time		*/
 
@@ -48,6 +50,7 @@ void	clkinit(void)
 	csrptr->tpir = 1000000;
 	csrptr->tnir = 0;
 	csrptr->tldr = 0xFFFFFFFF - 26000;
+	cycinit(26000);		/* Counter clocks per ms		*/
 
 	/* Set the timer to auto reload */
 
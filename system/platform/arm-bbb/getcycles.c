@@ -0,0 +1,31 @@
+/* getcycles.c - getcycles (BeagleBone Black) */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  getcycles  -  Return the count of 1 ms timer input clocks since boot,
+ *		    formed from the ms count and the timer's counter
+ *------------------------------------------------------------------------
+ */
+uint64	getcycles(void)
+{
+	volatile struct am335x_timer1ms *csrptr =
+	(volatile struct am335x_timer1ms *)AM335X_TIMER1MS_ADDR;
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	ms;			/* Milliseconds since boot	*/
+	uint32	count;			/* Clocks into the current ms	*/
+
+	mask = disable();
+	ms = (clktime * 1000) + clkticks;
+	count = csrptr->tcrr - csrptr->tldr;
+
+	/* If the counter overflowed but the interrupt has not been	*/
+	/*   handled, another ms has passed				*/
+
+	if (csrptr->tisr & AM335X_TIMER1MS_TISR_OVF_IT_FLAG) {
+		ms++;
+		count = csrptr->tcrr - csrptr->tldr;
+	}
+	restore(mask);
+	return ((uint64)ms * clkcyckhz) + count;
+}
@@ -2,18 +2,27 @@
 
 #ifdef GPIO
 
-void heartbeat() {
-  while (1) {
-    gpioLEDOn(GPIO_LED_USR0);
-    sleepms(100);
-    gpioLEDOff(GPIO_LED_USR0);
-    sleepms(200);
+/* Blink pattern: LED state and how long (ms) to hold it */
+
+local	const	struct	{
+	bool8	on;
+	uint32	hold;
+} beat[] = { {TRUE, 100}, {FALSE, 200}, {TRUE, 100}, {FALSE, 2000} };
+
+/*------------------------------------------------------------------------
+ * heartbeat  -  Callout that drives the LED blinker; each step sets the
+ *		 LED and rearms itself for the next step of the pattern
+ *------------------------------------------------------------------------
+ */
+void heartbeat(void *arg) {
+  uint32 step = (uint32)arg;
+
+  if (beat[step].on) {
     gpioLEDOn(GPIO_LED_USR0);
-    sleepms(100);
+  } else {
     gpioLEDOff(GPIO_LED_USR0);
-    sleep(2);
   }
+  timer_add(heartbeat, (void *)((step + 1) % 4), beat[step].hold);
 }
 
 #endif
-
@@ -1,39 +1,119 @@
-/* clkhandler.c - clkhandler */
+/* clkhandler.c - clkhandler, clkresume */
 
 #include <xinu.h>
 #include <platform.h>
 void wakeup(void);
+
+local ulong clklast;    /* clkcount() at the last accounted tick */
+
+/**
+ * @ingroup timer
+ *
+ * Returns the number of whole ticks that have elapsed since the last call,
+ * measured on the free-running counter so that ticks skipped while the
+ * clock was in a tickless one-shot are not lost.
+ */
+local uint32 clkelapsed(void)
+{
+    ulong perTick = platform.clkfreq / CLKTICKS_PER_SEC;
+    uint32 nticks = (clkcount() - clklast) / perTick;
+
+    clklast += nticks * perTick;
+    return nticks;
+}
+
+/**
+ * @ingroup timer
+ *
+ * Schedules the next timer interrupt for the tick boundary that lies
+ * nticks after the last accounted tick.
+ */
+local void clkprogram(uint32 nticks)
+{
+    ulong perTick = platform.clkfreq / CLKTICKS_PER_SEC;
+    long cycles = (long)((clklast + nticks * perTick) - clkcount());
+
+    clkupdate(cycles > 0 ? cycles : 1);
+}
+
 /**
  * @ingroup timer
  *
  * Interrupt handler function for the timer interrupt.  This schedules a new
- * timer interrupt to occur at some point in the future, then updates ::clktime
- * and ::clkticks, then wakes sleeping threads if there are any, otherwise
- * reschedules the processor.
+ * timer interrupt to occur at the next tick, then updates ::clktime and
+ * ::clkticks for every tick that has elapsed and advances the timing wheel to
+ * wake sleeping threads and run callouts, and reschedules the processor.  If
+ * only the null process can run, the next interrupt is instead scheduled for
+ * the next timer expiry (tickless idle).
  */
 interrupt clkhandler(void)
 {
-    clkupdate(platform.clkfreq / CLKTICKS_PER_SEC);
+    uint32 nticks = clkelapsed();
+    uint32 delay;
 
-    /* Another clock tick passes. */
-    clkticks++;
-	 
-    /* Update global second counter. */
-    if (CLKTICKS_PER_SEC == clkticks)
+    clkintr++;
+    clkidle = FALSE;
+    clkprogram(1);
+    getcycles();    /* Keep the 64-bit cycle count current */
+
+    resched_cntl(DEFER_START);
+    while (nticks-- > 0)
     {
-        clktime++;
-        clkticks = 0;
+        /* Another clock tick passes. */
+        clkticks++;
+
+        /* Update global second counter. */
+        if (CLKTICKS_PER_SEC == clkticks)
+        {
+            clktime++;
+            clkticks = 0;
+        }
+
+        /* Advance the timing wheel, waking sleepers and  */
+        /* running callouts that are due                  */
+        wakeup();
     }
+    resched();
 
-    /* If sleepq is not empty, decrement first key.   */
-    /* If key reaches zero, call wakeup.              */
-    if (nonempty(sleepq) && (--firstkey(sleepq) <= 0))
+    /* Nothing but the null process can run: sleep until the */
+    /* timing wheel next needs service                       */
+    if (clktickless && (currpid == NULLPROC) && isempty(readylist))
     {
-        wakeup();
+        delay = tmnextdelay(CLKMAXIDLE);
+        if (delay > 1)
+        {
+            clkprogram(delay);
+            clkidle = TRUE;
+        }
     }
-    else
+    resched_cntl(DEFER_STOP);
+}
+
+/**
+ * @ingroup timer
+ *
+ * Cuts a tickless one-shot short when a process other than the null process
+ * is about to run.  The interrupt arrives at the next tick boundary and
+ * accounts for the ticks that elapsed while idle.
+ */
+void clkresume(void)
+{
+    if (clkidle)
     {
-        resched();
+        clkidle = FALSE;
+        clkprogram((clkcount() - clklast) /
+                   (platform.clkfreq / CLKTICKS_PER_SEC) + 1);
     }
 }
 
+/**
+ * @ingroup timer
+ *
+ * Starts the tick accounting from the current value of the free-running
+ * counter and schedules the first timer interrupt.
+ */
+void clkstart(void)
+{
+    clklast = clkcount();
+    clkprogram(1);
+}
@@ -4,11 +4,13 @@
 #include <platform.h>
 uint32	clktime;		/* Seconds since boot			*/
 uint32	ctr1000 = 0;		/* Milliseconds since boot		*/
-qid16	sleepq;			/* Queue of sleeping processes		*/
 uint32	preempt;		/* Preemption counter			*/
 volatile ulong clkticks;
+bool8	clktickless = TRUE;	/* Tickless idle is enabled		*/
+bool8	clkidle = FALSE;	/* In a tickless one-shot		*/
+uint32	clkintr = 0;		/* Clock interrupts since boot		*/
 /*------------------------------------------------------------------------
- * clkinit  -  Initialize the clock and sleep queue at startup
+ * clkinit  -  Initialize the clock and timing wheel at startup
  *------------------------------------------------------------------------
  */
 void	clkinit(void)
@@ -18,9 +20,10 @@ void	clkinit(void)
         platform.clkfreq, CLKTICKS_PER_SEC);
 	interruptVector[IRQ_TIMER] = clkhandler;
 	enable_irq(IRQ_TIMER);
-	clkupdate(platform.clkfreq / CLKTICKS_PER_SEC);
-	sleepq = newqueue();	/* Allocate a queue to hold the delta	*/
-				/*   list of sleeping processes		*/
+	cycinit(platform.clkfreq / 1000);	/* Rate of SP804 counter*/
+	timerinit();		/* Initialize the timing wheel for	*/
+				/*   sleeping processes			*/
+	clkstart();		/* Start counting ticks			*/
 
 	preempt = QUANTUM;	/* Set the preemption time		*/
 
@@ -0,0 +1,29 @@
+/* getcycles.c - getcycles (arm-qemu) */
+
+#include <xinu.h>
+
+local	uint32	cychigh = 0;		/* Wraps of the 32-bit counter	*/
+local	uint32	cyclast = 0;		/* Counter at the last reading	*/
+
+/*------------------------------------------------------------------------
+ *  getcycles  -  Read the free-running SP804 counter, extended to 64
+ *		    bits (the clock handler reads it at least once per
+ *		    second, well within one wrap of the counter)
+ *------------------------------------------------------------------------
+ */
+uint64	getcycles(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	uint32	now;			/* Current value of the counter	*/
+	uint64	cycles;			/* Extended value		*/
+
+	mask = disable();
+	now = clkcount();
+	if (now < cyclast) {
+		cychigh++;
+	}
+	cyclast = now;
+	cycles = ((uint64)cychigh << 32) | now;
+	restore(mask);
+	return cycles;
+}
@@ -78,7 +78,9 @@ void dispatch(void)
     do
     {
         uint irq = 31 - __builtin_clz(status);
+        trace(TR_INTR, irq, 0);
         interruptVector[irq]();
+        trace(TR_INTREND, irq, 0);
         status ^= 1U << irq;
     }
     while (status);
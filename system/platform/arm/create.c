@@ -26,6 +26,7 @@ pid32   create(
     int32       i;
     uint32      *a;     /* points to list of args   */
     uint32      *saddr;     /* stack address        */
+    uint32      *fill;      /* walks the unused stack   */
 
     mask = disable();
     if (ssize < MINSTK)
@@ -52,6 +53,9 @@ pid32   create(
     prptr->prsem = -1;
     prptr->prparent = (pid32)getpid();
     prptr->prhasmsg = FALSE;
+    prptr->prvolsw = prptr->prinvolsw = 0;
+    prptr->prcycles = 0;
+    prptr->prwaitcyc = prptr->prfwaitcyc = prptr->prsleepcyc = 0;
 
     /* set up initial device descriptors for the shell      */
     prptr->prdesc[0] = CONSOLE; /* stdin  is CONSOLE device */
@@ -62,6 +66,11 @@ pid32   create(
 
     *saddr = STACKMAGIC;
 
+    /* fill the rest of the stack so stkhwm can find its deepest use */
+    for (fill = (uint32 *)((uint32)saddr - ssize + sizeof(uint32));
+                        fill < saddr; fill++)
+        *fill = STACKFILL;
+
     /* push arguments */
     a = (uint32 *)(&nargs + 1); /* start of args        */
     a += nargs -1;          /* last argument        */
@@ -1,45 +1,134 @@
-/* clkhandler.c - clkhandler */
+/* clkhandler.c - clkhandler, clkperiodic, clkoneshot, clkresume */
 
 #include <xinu.h>
 
+local	uint32	clkprog = 1;	/* Milliseconds to account for when the	*/
+				/*   next clock interrupt arrives	*/
+local	bool8	clkshot = FALSE;/* PIT is in one-shot mode		*/
+
 /*------------------------------------------------------------------------
  * clkhandler - high level clock interrupt handler
  *------------------------------------------------------------------------
  */
 void	clkhandler()
 {
-	static	uint32	count1000 = 1000;	/* Count to 1000 ms	*/
+	uint32	nticks;		/* Milliseconds since last interrupt	*/
+	uint32	delay;		/* Length of a tickless one-shot	*/
+
+	trace(TR_INTR, 0, 0);
+	clkintr++;
+	nticks = clkprog;
 
-	/* Decrement the ms counter, and see if a second has passed */
+	/* A one-shot has expired, so return to the periodic tick */
 
-	if((--count1000) <= 0) {
+	if (clkshot) {
+		clkperiodic();
+	}
+	clkidle = FALSE;
 
-		/* One second has passed, so increment seconds count */
+	/* Defer rescheduling until every elapsed tick is accounted for	*/
 
-		clktime++;
+	resched_cntl(DEFER_START);
+	while (nticks-- > 0) {
 
-		/* Reset the local ms counter for the next second */
+		/* Count the ms, and see if a second has passed */
 
-		count1000 = 1000;
-	}
+		if (++clkticks >= CLKTICKS_PER_SEC) {
+			clktime++;
+			clkticks = 0;
+		}
+
+		/* Advance the timing wheel, awakening sleeping	*/
+		/*   processes and running callouts that are due	*/
 
-	/* Handle sleeping processes if any exist */
+		wakeup();
 
-	if(!isempty(sleepq)) {
+		/* Decrement the preemption counter, and reschedule	*/
+		/*   when the remaining time reaches zero		*/
+
+		if((--preempt) <= 0) {
+			preempt = QUANTUM;
+			resched();
+		}
+	}
 
-		/* Decrement the delay for the first process on the	*/
-		/*   sleep queue, and awaken if the count reaches zero	*/
+	/* If only the null process can run, skip the ticks until the	*/
+	/*   wheel next needs service					*/
 
-		if((--queuetab[firstid(sleepq)].qkey) <= 0) {
-			wakeup();
+	if (clktickless && (currpid == NULLPROC) && isempty(readylist)) {
+		delay = tmnextdelay(CLKMAXIDLE);
+		if (delay > 1) {
+			clkoneshot(delay * CLKCNT_MS, delay);
+			clkidle = TRUE;
 		}
 	}
+	trace(TR_INTREND, 0, 0);
+	resched_cntl(DEFER_STOP);
+}
+
+/*------------------------------------------------------------------------
+ * clkperiodic - Program the PIT to interrupt once every millisecond
+ *------------------------------------------------------------------------
+ */
+void	clkperiodic(void)
+{
+	outb(CLKCNTL, CLKMODE_RATE);
+
+	/* Using 1193 instead of 1190 to fix clock skew; the count is	*/
+	/*   written LSB first, then MSB				*/
+
+	outb(CLOCK0, (char) (0xff & CLKCNT_MS) );
+	outb(CLOCK0, (char) (0xff & (CLKCNT_MS>>8)));
+	clkprog = 1;
+	clkshot = FALSE;
+}
+
+/*------------------------------------------------------------------------
+ * clkoneshot - Program the PIT to interrupt once after count input
+ *		  clocks, which span nticks milliseconds
+ *------------------------------------------------------------------------
+ */
+void	clkoneshot(
+	  uint32	count,		/* PIT counts until interrupt	*/
+	  uint32	nticks		/* Milliseconds to account	*/
+	)
+{
+	outb(CLKCNTL, CLKMODE_ONESHOT);
+	outb(CLOCK0, (char) (0xff & count) );
+	outb(CLOCK0, (char) (0xff & (count>>8)));
+	clkprog = nticks;
+	clkshot = TRUE;
+}
+
+/*------------------------------------------------------------------------
+ * clkresume - Cut a tickless one-shot short when a process other than
+ *		 the null process is about to run; the interrupt arrives
+ *		 at the next millisecond boundary and accounts for the
+ *		 ticks that have elapsed
+ *------------------------------------------------------------------------
+ */
+void	clkresume(void)			/* Assumes interrupts disabled	*/
+{
+	uint32	remain;			/* PIT counts left in one-shot	*/
+	uint32	whole;			/* Whole ms left in one-shot	*/
+	uint32	part;			/* Counts left in the current ms*/
+
+	if (!clkidle) {
+		return;
+	}
+	clkidle = FALSE;
 
-	/* Decrement the preemption counter, and reschedule when the */
-	/*   remaining time reaches zero			     */
+	outb(CLKCNTL, CLKLATCH);
+	remain = inb(CLOCK0) & 0xff;
+	remain |= (inb(CLOCK0) & 0xff) << 8;
 
-	if((--preempt) <= 0) {
-		preempt = QUANTUM;
-		resched();
+	if (remain == 0) {		/* Interrupt is already pending	*/
+		return;
+	}
+	whole = (remain - 1) / CLKCNT_MS;
+	part = remain - whole * CLKCNT_MS;
+	if (whole >= clkprog) {		/* Count not started yet	*/
+		whole = clkprog - 1;
 	}
+	clkoneshot(part, clkprog - whole);
 }
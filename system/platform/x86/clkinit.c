@@ -4,20 +4,21 @@
 
 uint32	clktime;		/* Seconds since boot			*/
 uint32	ctr1000 = 0;		/* Milliseconds since boot		*/
-qid16	sleepq;			/* Queue of sleeping processes		*/
 uint32	preempt;		/* Preemption counter			*/
+volatile ulong clkticks;	/* Milliseconds within current second	*/
+bool8	clktickless = TRUE;	/* Tickless idle is enabled		*/
+bool8	clkidle;		/* In a tickless one-shot		*/
+uint32	clkintr;		/* Clock interrupts since boot		*/
 
 /*------------------------------------------------------------------------
- * clkinit  -  Initialize the clock and sleep queue at startup (x86)
+ * clkinit  -  Initialize the clock and timing wheel at startup (x86)
  *------------------------------------------------------------------------
  */
 void	clkinit(void)
 {
-	uint16	intv;		/* Clock rate in KHz			*/
+	/* Initialize the timing wheel for sleeping processes		*/
 
-	/* Allocate a queue to hold the delta list of sleeping processes*/
-
-	sleepq = newqueue();
+	timerinit();
 
 	/* Initialize the preemption count */
 
@@ -26,24 +27,21 @@ void	clkinit(void)
 	/* Initialize the time since boot to zero */
 
 	clktime = 0;
+	clkticks = 0;
+	clkidle = FALSE;
+	clkintr = 0;
 
-	/* Set interrupt vector for the clock to invoke clkdisp */
-
-	set_evec(IRQBASE, (uint32)clkdisp);
+	/* Measure the rate of the time stamp counter */
 
-	/* Set the hardware clock: timer 0, 16-bit counter, rate */
-	/*   generator mode, and counter runs in binary		 */
+	cycinit(cyccalibrate());
 
-	outb(CLKCNTL, 0x34);
-
-	/* Set the clock rate to 1.190 Mhz; this is 1 ms interrupt rate */
+	/* Set interrupt vector for the clock to invoke clkdisp */
 
-	intv = 1193;	/* Using 1193 instead of 1190 to fix clock skew	*/
+	set_evec(IRQBASE, (uint32)clkdisp);
 
-	/* Must write LSB first, then MSB */
+	/* Start the hardware clock with a 1 ms periodic interrupt */
 
-	outb(CLOCK0, (char) (0xff & intv) );
-	outb(CLOCK0, (char) (0xff & (intv>>8)));
+	clkperiodic();
 
 	return;
 }
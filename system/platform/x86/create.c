@@ -24,6 +24,7 @@ pid32	create(
 	int32		i;
 	uint32		*a;		/* Points to list of args	*/
 	uint32		*saddr;		/* Stack address		*/
+	uint32		*fill;		/* Walks the unused stack	*/
 
 	mask = disable();
 	if (ssize < MINSTK)
@@ -49,6 +50,9 @@ pid32	create(
 	prptr->prsem = -1;
 	prptr->prparent = (pid32)getpid();
 	prptr->prhasmsg = FALSE;
+	prptr->prvolsw = prptr->prinvolsw = 0;
+	prptr->prcycles = 0;
+	prptr->prwaitcyc = prptr->prfwaitcyc = prptr->prsleepcyc = 0;
 
 	/* Set up stdin, stdout, and stderr descriptors for the shell	*/
 	prptr->prdesc[0] = CONSOLE;
@@ -60,6 +64,14 @@ pid32	create(
 	*saddr = STACKMAGIC;
 	savsp = (uint32)saddr;
 
+	/* Fill the rest of the stack so that stkhwm can find how deep	*/
+	/*   the process has ever pushed				*/
+
+	for (fill = (uint32 *)((uint32)saddr - ssize + sizeof(uint32));
+						fill < saddr; fill++) {
+		*fill = STACKFILL;
+	}
+
 	/* Push arguments */
 	a = (uint32 *)(&nargs + 1);	/* Start of args		*/
 	a += nargs -1;			/* Last argument		*/
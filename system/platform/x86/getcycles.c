@@ -0,0 +1,53 @@
+/* getcycles.c - getcycles, cyccalibrate (x86) */
+
+#include <xinu.h>
+
+#define	PIT2_DATA	0x42		/* PIT counter 2 data port	*/
+#define	PIT2_MODE	0xB0		/* Counter 2, LSB/MSB, mode 0	*/
+#define	PIT2_GATE	0x61		/* Counter 2 gate and output	*/
+#define	PIT2_GATEON	0x01		/* Gate input of counter 2	*/
+#define	PIT2_SPKR	0x02		/* Speaker enable		*/
+#define	PIT2_OUT	0x20		/* Output of counter 2		*/
+#define	CALMS		10		/* Length of calibration (ms)	*/
+
+/*------------------------------------------------------------------------
+ *  getcycles  -  Read the processor's time stamp counter
+ *------------------------------------------------------------------------
+ */
+uint64	getcycles(void)
+{
+	uint64	cycles;			/* Value of the TSC		*/
+
+	asm volatile ("rdtsc" : "=A" (cycles));
+	return cycles;
+}
+
+/*------------------------------------------------------------------------
+ *  cyccalibrate  -  Measure the rate of the time stamp counter against
+ *		       counter 2 of the PIT and return it in kHz
+ *------------------------------------------------------------------------
+ */
+uint32	cyccalibrate(void)		/* Assumes interrupts disabled	*/
+{
+	uint64	start, end;		/* TSC at the ends of the delay	*/
+	uint32	count;			/* PIT counts in CALMS ms	*/
+
+	/* Enable the gate of counter 2 with the speaker off, and	*/
+	/*   start a one-shot count					*/
+
+	outb(PIT2_GATE, (inb(PIT2_GATE) & ~PIT2_SPKR) | PIT2_GATEON);
+	count = CALMS * CLKCNT_MS;
+	outb(CLKCNTL, PIT2_MODE);
+	outb(PIT2_DATA, (char) (0xff & count));
+	outb(PIT2_DATA, (char) (0xff & (count>>8)));
+
+	/* The output of counter 2 goes high when the count expires	*/
+
+	start = getcycles();
+	while ((inb(PIT2_GATE) & PIT2_OUT) == 0) {
+		;
+	}
+	end = getcycles();
+
+	return (uint32)(end - start) / CALMS;
+}
@@ -13,16 +13,35 @@ status	ready(
 	)
 {
 	register struct procent *prptr;
+	uint64	blocked;		/* Cycles spent blocked		*/
 
 	if (isbadpid(pid)) {
 		return SYSERR;
 	}
 
-	/* Set process state to indicate ready and add to ready list */
+	/* Charge the time just spent blocked to the state it was in	*/
 
 	prptr = &proctab[pid];
+	blocked = getcycles() - prptr->prblkstart;
+	if (prptr->prstate == PR_WAIT) {
+		prptr->prwaitcyc += blocked;
+	} else if (prptr->prstate == PR_FWAIT) {
+		prptr->prfwaitcyc += blocked;
+	} else if ((prptr->prstate == PR_SLEEP)
+		   || (prptr->prstate == PR_RECTIM)) {
+		prptr->prsleepcyc += blocked;
+	}
+
+	/* A timed wait that ends early no longer needs its timer	*/
+
+	if ((prptr->prstate == PR_WAIT) || (prptr->prstate == PR_FWAIT)) {
+		tmdequeue(pid);
+	}
+
+	/* Set process state to indicate ready and add to ready list */
+
 	prptr->prstate = PR_READY;
-	insert(pid, readylist, prptr->prprio);
+	rqinsert(pid, prptr->prprio);
 	resched();
 
 	return OK;
@@ -23,10 +23,7 @@ umsg32	recvtime(
 
 	prptr = &proctab[currpid];
 	if (prptr->prhasmsg == FALSE) {	/* If message waiting, no delay	*/
-		if (insertd(currpid,sleepq,maxwait) == SYSERR) {
-			restore(mask);
-			return SYSERR;
-		}
+		tmenqueue(currpid, tmnow + (maxwait > 0 ? maxwait : 1));
 		prptr->prstate = PR_RECTIM;
 		resched();
 	}
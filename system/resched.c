@@ -3,6 +3,8 @@
 #include <xinu.h>
 
 struct	defer	Defer;
+uint64	currstart;		/* Cycle count when currpid started	*/
+uint32	nctxsw;			/* Context switches since boot		*/
 
 /*------------------------------------------------------------------------
  *  resched  -  Reschedule processor to highest priority eligible process
@@ -12,6 +14,7 @@ void	resched(void)		/* Assumes interrupts are disabled	*/
 {
 	struct procent *ptold;	/* Ptr to table entry for old process	*/
 	struct procent *ptnew;	/* Ptr to table entry for new process	*/
+	uint64	now;		/* Cycle count at the switch		*/
 
 	/* If rescheduling is deferred, record attempt and return */
 
@@ -32,16 +35,35 @@ void	resched(void)		/* Assumes interrupts are disabled	*/
 		/* Old process will no longer remain current */
 
 		ptold->prstate = PR_READY;
-		insert(currpid, readylist, ptold->prprio);
+		rqinsert(currpid, ptold->prprio);
+		ptold->prinvolsw++;
+	} else {
+		ptold->prvolsw++;
 	}
 
+	/* Charge the old process for the cycles it has just used	*/
+
+	now = getcycles();
+	ptold->prcycles += now - currstart;
+	ptold->prblkstart = now;
+	currstart = now;
+
 	/* Force context switch to highest priority ready process */
 
-	currpid = dequeue(readylist);
+	currpid = rqdequeue();
 	ptnew = &proctab[currpid];
 	ptnew->prstate = PR_CURR;
 	preempt = QUANTUM;		/* Reset time slice for process	*/
 
+	nctxsw++;
+	trace(TR_CTXSW, ptold - proctab, currpid);
+
+	/* Restart the periodic tick when leaving tickless idle */
+
+	if (clkidle) {
+		clkresume();
+	}
+
 #ifdef MMU
 	FlushTLB();
 	setPageTable();
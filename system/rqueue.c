@@ -0,0 +1,171 @@
+/* rqueue.c - rqinit, rqinsert, rqremove, rqdequeue, rqhigher */
+
+#include <xinu.h>
+
+local	int32	rqhigher(int32);
+
+local	uint32	rqmap[NRQWORDS];	/* One bit per nonempty bucket	*/
+local	uint32	rqsummary;		/* One bit per nonzero rqmap[]	*/
+local	pid32	rqtail[NRQPRIO];	/* Last process in each bucket	*/
+
+/*------------------------------------------------------------------------
+ *  rqinit  -  Initialize the index of the ready list
+ *------------------------------------------------------------------------
+ */
+void	rqinit(void)
+{
+	int32	i;			/* Index into tables		*/
+
+	for (i = 0; i < NRQWORDS; i++) {
+		rqmap[i] = 0;
+	}
+	rqsummary = 0;
+	for (i = 0; i < NRQPRIO; i++) {
+		rqtail[i] = EMPTY;
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  rqinsert  -  Insert a process in the ready list behind all processes
+ *		   of equal or higher priority in constant time
+ *------------------------------------------------------------------------
+ */
+status	rqinsert(			/* Assumes interrupts disabled	*/
+	  pid32		pid,		/* ID of process to insert	*/
+	  int32		key		/* Priority of the process	*/
+	)
+{
+	int32	b;			/* Bucket for the priority	*/
+	int32	higher;			/* Nearest higher bucket in use	*/
+	qid16	prev, next;		/* Nodes around insertion point	*/
+
+	if (isbadpid(pid)) {
+		return SYSERR;
+	}
+
+	b = rqbucket(key);
+	if (!rqshared(b) && (rqtail[b] != EMPTY)) {
+
+		/* All processes in the bucket have the same priority	*/
+
+		prev = rqtail[b];
+	} else {
+
+		/* Start behind the lowest priority process of the	*/
+		/*   nearest higher bucket, or at the head of the list	*/
+
+		higher = rqhigher(b);
+		if (higher == EMPTY) {
+			prev = queuehead(readylist);
+		} else {
+			prev = rqtail[higher];
+		}
+
+		/* A shared bucket holds several priorities, so skip	*/
+		/*   the ones that are not lower than the new key	*/
+
+		if (rqshared(b)) {
+			next = queuetab[prev].qnext;
+			while ((next < NPROC) && (queuetab[next].qkey >= key)) {
+				prev = next;
+				next = queuetab[next].qnext;
+			}
+		}
+	}
+
+	/* Link the process in after prev */
+
+	next = queuetab[prev].qnext;
+	queuetab[pid].qnext = next;
+	queuetab[pid].qprev = prev;
+	queuetab[pid].qkey = key;
+	queuetab[prev].qnext = pid;
+	queuetab[next].qprev = pid;
+
+	if ((rqtail[b] == EMPTY) || (rqtail[b] == prev)) {
+		rqtail[b] = pid;
+	}
+	rqmap[b >> 5] |= (1 << (b & 31));
+	rqsummary |= (1 << (b >> 5));
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  rqremove  -  Remove a process from an arbitrary point in the ready
+ *		   list and keep the bucket index consistent
+ *------------------------------------------------------------------------
+ */
+pid32	rqremove(			/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of process to remove	*/
+	)
+{
+	int32	b;			/* Bucket that holds the process*/
+	qid16	prev;			/* Node ahead of the process	*/
+
+	b = rqbucket(queuetab[pid].qkey);
+	if (rqtail[b] == pid) {
+		prev = queuetab[pid].qprev;
+		if ((prev < NPROC) && (rqbucket(queuetab[prev].qkey) == b)) {
+			rqtail[b] = prev;
+		} else {
+			rqtail[b] = EMPTY;
+			rqmap[b >> 5] &= ~(1 << (b & 31));
+			if (rqmap[b >> 5] == 0) {
+				rqsummary &= ~(1 << (b >> 5));
+			}
+		}
+	}
+	return getitem(pid);
+}
+
+/*------------------------------------------------------------------------
+ *  rqdequeue  -  Remove and return the highest priority ready process
+ *------------------------------------------------------------------------
+ */
+pid32	rqdequeue(void)			/* Assumes interrupts disabled	*/
+{
+	pid32	pid;			/* ID of process removed	*/
+
+	if (isempty(readylist)) {
+		return EMPTY;
+	}
+	pid = rqremove(firstid(readylist));
+	queuetab[pid].qprev = EMPTY;
+	queuetab[pid].qnext = EMPTY;
+	return pid;
+}
+
+/*------------------------------------------------------------------------
+ *  rqhigher  -  Return the lowest nonempty bucket above bucket b, or
+ *		   EMPTY if no higher bucket holds a process
+ *------------------------------------------------------------------------
+ */
+local	int32	rqhigher(
+	  int32		b		/* Bucket to search above	*/
+	)
+{
+	int32	w;			/* Word of the bitmap		*/
+	uint32	bits;			/* Candidate bits in a word	*/
+
+	/* Look first in the rest of the word that holds bucket b	*/
+
+	w = b >> 5;
+	if ((b & 31) != 31) {
+		bits = rqmap[w] & (~0U << ((b & 31) + 1));
+		if (bits != 0) {
+			return (w << 5) + __builtin_ctz(bits);
+		}
+	}
+
+	/* Then find the first nonempty word above it		*/
+
+	if (w == NRQWORDS - 1) {
+		return EMPTY;
+	}
+	bits = rqsummary & (~0U << (w + 1));
+	if (bits == 0) {
+		return EMPTY;
+	}
+	w = __builtin_ctz(bits);
+	return (w << 5) + __builtin_ctz(rqmap[w]);
+}
@@ -23,6 +23,7 @@ syscall	signal(
 		restore(mask);
 		return SYSERR;
 	}
+	trace(TR_SIGNAL, sem, semptr->scount);
 	if ((semptr->scount++) < 0) {	/* Release a waiting process */
 		ready(dequeue(semptr->squeue));
 	}
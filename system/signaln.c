@@ -25,6 +25,7 @@ syscall	signaln(
 		return SYSERR;
 	}
 
+	trace(TR_SIGNAL, sem, semptr->scount);
 	resched_cntl(DEFER_START);
 	for (; count > 0; count--) {
 		if ((semptr->scount++) < 0) {
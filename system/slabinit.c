@@ -0,0 +1,60 @@
+/* slabinit.c - slabinit, slabindex */
+
+#include <xinu.h>
+
+struct	slabclass slabtab[NSLABCLS];	/* Size class table		*/
+
+/*------------------------------------------------------------------------
+ *  slabinit  -  Initialize the size classes of the slab allocator
+ *------------------------------------------------------------------------
+ */
+status	slabinit(void)
+{
+	int32	i;			/* Index into slabtab		*/
+	uint32	size;			/* Object size of a class	*/
+	struct	slabclass *scptr;	/* Pointer to entry in slabtab	*/
+
+	size = SLAB_MINSIZE;
+	for (i = 0; i < NSLABCLS; i++) {
+		scptr = &slabtab[i];
+		scptr->scsize = size;
+
+		/* Large classes use larger pages so that each page	*/
+		/*   still holds a reasonable number of objects		*/
+
+		scptr->scpagesz = SLAB_MINPAGE;
+		while (scptr->scpagesz < size * SLAB_PERPAGE) {
+			scptr->scpagesz <<= 1;
+		}
+		scptr->scperpage = (scptr->scpagesz -
+			(uint32)roundmb(sizeof(struct slabpage))) / size;
+		scptr->scpages = NULL;
+		scptr->scnpages = 0;
+		scptr->scempty = 0;
+		scptr->scinuse = 0;
+		scptr->scallocs = 0;
+		scptr->schits = 0;
+		scptr->scfrees = 0;
+		size <<= 1;
+	}
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  slabindex  -  Return the smallest size class that holds nbytes, or
+ *			SYSERR if the request is too large for any class
+ *------------------------------------------------------------------------
+ */
+int32	slabindex(
+	  uint32	nbytes		/* Size of request in bytes	*/
+	)
+{
+	int32	i;			/* Index into slabtab		*/
+
+	for (i = 0; i < NSLABCLS; i++) {
+		if (nbytes <= slabtab[i].scsize) {
+			return i;
+		}
+	}
+	return SYSERR;
+}
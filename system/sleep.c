@@ -38,11 +38,7 @@ syscall	sleepms(
 
 	/* Delay calling process */
 
-	if (insertd(currpid, sleepq, delay) == SYSERR) {
-		restore(mask);
-		return SYSERR;
-	}
-
+	tmenqueue(currpid, tmnow + delay);
 	proctab[currpid].prstate = PR_SLEEP;
 	resched();
 	restore(mask);
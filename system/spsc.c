@@ -0,0 +1,150 @@
+/* spsc.c - spsc_alloc, spsc_free, spsc_put, spsc_get */
+
+#include <xinu.h>
+#include <spsc.h>
+
+/* Keep the compiler from moving slot copies past an index update	*/
+#define	spsc_barrier()	__asm__ __volatile__ ("" : : : "memory")
+
+/*------------------------------------------------------------------------
+ *  spsc_park  -  Block the caller while *index still holds val, the way
+ *		  a futex waits on a word (internal)
+ *------------------------------------------------------------------------
+ */
+static	void	spsc_park(
+	  struct spsc	*ring,		/* Ring to wait on		*/
+	  volatile uint32 *index,	/* Index the other side moves	*/
+	  uint32	val		/* Value seen before blocking	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	/* Check again with interrupts off: if the other side moved	*/
+	/*   the index since the caller looked, there is no need to	*/
+	/*   block, and otherwise it cannot move until we are parked	*/
+
+	mask = disable();
+	if (*index == val) {
+		ring->waiter = currpid;
+		suspend(currpid);
+	}
+	restore(mask);
+}
+
+/*------------------------------------------------------------------------
+ *  spsc_wake  -  Resume the process parked on a ring, if any (internal)
+ *------------------------------------------------------------------------
+ */
+static	void	spsc_wake(
+	  struct spsc	*ring		/* Ring whose index just moved	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	pid32	pid;			/* Process to resume		*/
+
+	if (ring->waiter == EMPTY) {	/* Common case: no one to wake	*/
+		return;
+	}
+	mask = disable();
+	pid = ring->waiter;
+	ring->waiter = EMPTY;
+	if (pid != EMPTY) {
+		resume(pid);
+	}
+	restore(mask);
+}
+
+/*------------------------------------------------------------------------
+ *  spsc_alloc  -  Allocate a ring of nelems elements of size bytes
+ *------------------------------------------------------------------------
+ */
+struct	spsc	*spsc_alloc(
+	  uint32	size,		/* Bytes in one element		*/
+	  uint32	nelems		/* Elements the ring can hold	*/
+	)
+{
+	struct	spsc	*ring;		/* Ring to return		*/
+
+	if (size == 0 || nelems == 0) {
+		return NULL;
+	}
+	ring = (struct spsc *)getmem(sizeof(struct spsc));
+	if (ring == (struct spsc *)SYSERR) {
+		return NULL;
+	}
+	ring->data = getmem(size * (nelems + 1));
+	if (ring->data == (char *)SYSERR) {
+		freemem((char *)ring, sizeof(struct spsc));
+		return NULL;
+	}
+	ring->head = ring->tail = 0;
+	ring->size = size;
+	ring->nslots = nelems + 1;
+	ring->waiter = EMPTY;
+	return ring;
+}
+
+/*------------------------------------------------------------------------
+ *  spsc_free  -  Release a ring that neither side is using any more
+ *------------------------------------------------------------------------
+ */
+syscall	spsc_free(
+	  struct spsc	*ring		/* Ring to free			*/
+	)
+{
+	if (ring == NULL || ring->waiter != EMPTY) {
+		return SYSERR;
+	}
+	freemem(ring->data, ring->size * ring->nslots);
+	freemem((char *)ring, sizeof(struct spsc));
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  spsc_put  -  Copy one element into a ring, blocking while it is full
+ *		 (producer side only)
+ *------------------------------------------------------------------------
+ */
+syscall	spsc_put(
+	  struct spsc	*ring,		/* Ring to add to		*/
+	  char		*in		/* Element to copy in		*/
+	)
+{
+	uint32	head;			/* Slot to fill			*/
+	uint32	next;			/* Head after this element	*/
+
+	head = ring->head;
+	next = (head + 1 == ring->nslots) ? 0 : head + 1;
+	while (ring->tail == next) {	/* Full: wait for the consumer	*/
+		spsc_park(ring, &ring->tail, next);
+	}
+	memcpy(ring->data + head * ring->size, in, ring->size);
+	spsc_barrier();
+	ring->head = next;
+	spsc_wake(ring);
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  spsc_get  -  Copy one element out of a ring, blocking while it is
+ *		 empty (consumer side only)
+ *------------------------------------------------------------------------
+ */
+syscall	spsc_get(
+	  struct spsc	*ring,		/* Ring to take from		*/
+	  char		*out		/* Where to copy the element	*/
+	)
+{
+	uint32	tail;			/* Slot to read			*/
+
+	tail = ring->tail;
+	while (ring->head == tail) {	/* Empty: wait for the producer	*/
+		spsc_park(ring, &ring->head, tail);
+	}
+	spsc_barrier();
+	memcpy(out, ring->data + tail * ring->size, ring->size);
+	spsc_barrier();
+	ring->tail = (tail + 1 == ring->nslots) ? 0 : tail + 1;
+	spsc_wake(ring);
+	return OK;
+}
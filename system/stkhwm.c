@@ -0,0 +1,35 @@
+/* stkhwm.c - stkhwm */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  stkhwm  -  Return the most stack space (in bytes) a process has used
+ *------------------------------------------------------------------------
+ */
+int32	stkhwm(
+	  pid32		pid		/* ID of process to examine	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	procent *prptr;		/* Ptr to process' table entry	*/
+	uint32	*low;			/* Lowest word of the stack	*/
+	uint32	*top;			/* Word holding STACKMAGIC	*/
+
+	mask = disable();
+	if (isbadpid(pid) || (pid == NULLPROC)) {
+		restore(mask);	/* Null process runs on boot stack	*/
+		return SYSERR;
+	}
+	prptr = &proctab[pid];
+
+	/* create fills the stack with STACKFILL; the first word from	*/
+	/*   the bottom that has changed marks the deepest push		*/
+
+	top = (uint32 *)prptr->prstkbase;
+	low = (uint32 *)((uint32)top - prptr->prstklen + sizeof(uint32));
+	while ((low < top) && (*low == STACKFILL)) {
+		low++;
+	}
+	restore(mask);
+	return (int32)((uint32)top - (uint32)low + sizeof(uint32));
+}
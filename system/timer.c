@@ -0,0 +1,149 @@
+/* timer.c - timerinit, tmenqueue, tmdequeue, tmcascade, tmnextdelay */
+
+#include <xinu.h>
+
+struct	tmentry	tmtab[NTMENT];		/* Timers and wheel slot heads	*/
+uint32	tmnow;				/* Milliseconds processed	*/
+int32	tmcount;			/* Timers currently scheduled	*/
+
+/*------------------------------------------------------------------------
+ *  timerinit  -  Initialize the timing wheel at startup
+ *------------------------------------------------------------------------
+ */
+void	timerinit(void)
+{
+	int32	i;			/* Index into tmtab		*/
+
+	for (i = 0; i < NTIMER; i++) {
+		tmtab[i].tmnext = tmtab[i].tmprev = EMPTY;
+		tmtab[i].tmfunc = NULL;
+		tmtab[i].tmarg = NULL;
+	}
+	for (i = NTIMER; i < NTMENT; i++) {
+		tmtab[i].tmnext = tmtab[i].tmprev = i;
+	}
+	tmnow = 0;
+	tmcount = 0;
+}
+
+/*------------------------------------------------------------------------
+ *  tmenqueue  -  Place a timer in the wheel slot for its expiry time
+ *------------------------------------------------------------------------
+ */
+void	tmenqueue(			/* Assumes interrupts disabled	*/
+	  int32		tid,		/* Index of the timer in tmtab	*/
+	  uint32	expire		/* Absolute time of expiry	*/
+	)
+{
+	uint32	delta;			/* Time remaining until expiry	*/
+	int32	head;			/* Head of the chosen slot	*/
+	int32	level;			/* Level of the wheel		*/
+	int32	shift;			/* Bits below the level's index	*/
+
+	tmtab[tid].tmexpire = expire;
+	delta = expire - tmnow;
+
+	if ((int32)delta < 0) {
+
+		/* Already expired: fire on the tick being processed	*/
+
+		head = tmslot(tmnow & (TMSLOTS0 - 1));
+	} else if (delta < TMSLOTS0) {
+		head = tmslot(expire & (TMSLOTS0 - 1));
+	} else {
+
+		/* Pick the lowest level whose span covers the delay;	*/
+		/*   longer delays wait in the last slot of the top	*/
+		/*   level and are placed again when it cascades	*/
+
+		if (delta >= TMMAXDELTA) {
+			expire = tmnow + TMMAXDELTA - 1;
+			delta = TMMAXDELTA - 1;
+		}
+		shift = TMBITS0;
+		for (level = 1; level < NTMLEVEL - 1; level++) {
+			if (delta < (1 << (shift + TMBITSN))) {
+				break;
+			}
+			shift += TMBITSN;
+		}
+		head = tmslot(TMSLOTS0 + (level - 1) * TMSLOTSN
+				+ ((expire >> shift) & (TMSLOTSN - 1)));
+	}
+
+	/* Append the timer at the tail of the slot list */
+
+	tmtab[tid].tmnext = head;
+	tmtab[tid].tmprev = tmtab[head].tmprev;
+	tmtab[tmtab[head].tmprev].tmnext = tid;
+	tmtab[head].tmprev = tid;
+	tmcount++;
+}
+
+/*------------------------------------------------------------------------
+ *  tmdequeue  -  Remove a timer from the wheel, if it is scheduled
+ *------------------------------------------------------------------------
+ */
+status	tmdequeue(			/* Assumes interrupts disabled	*/
+	  int32		tid		/* Index of the timer in tmtab	*/
+	)
+{
+	struct	tmentry	*tmptr;		/* Ptr to the timer's entry	*/
+
+	tmptr = &tmtab[tid];
+	if (tmptr->tmnext == EMPTY) {
+		return SYSERR;
+	}
+	tmtab[tmptr->tmprev].tmnext = tmptr->tmnext;
+	tmtab[tmptr->tmnext].tmprev = tmptr->tmprev;
+	tmptr->tmnext = tmptr->tmprev = EMPTY;
+	tmcount--;
+	return OK;
+}
+
+/*------------------------------------------------------------------------
+ *  tmcascade  -  Move the timers of one slot of a higher level down to
+ *		    the slots that now cover their expiry times
+ *------------------------------------------------------------------------
+ */
+void	tmcascade(			/* Assumes interrupts disabled	*/
+	  int32		level,		/* Level to cascade (> 0)	*/
+	  int32		index		/* Slot within the level	*/
+	)
+{
+	int32	head;			/* Head of the slot list	*/
+	int32	tid;			/* Timer being moved		*/
+
+	head = tmslot(TMSLOTS0 + (level - 1) * TMSLOTSN + index);
+	while (!tmempty(head)) {
+		tid = tmtab[head].tmnext;
+		tmdequeue(tid);
+		tmenqueue(tid, tmtab[tid].tmexpire);
+	}
+}
+
+/*------------------------------------------------------------------------
+ *  tmnextdelay  -  Return the number of ms until the wheel next needs
+ *		      service (a level 0 slot that holds a timer or the
+ *		      wrap of level 0), limited to maxdelay
+ *------------------------------------------------------------------------
+ */
+uint32	tmnextdelay(			/* Assumes interrupts disabled	*/
+	  uint32	maxdelay	/* Largest delay of interest	*/
+	)
+{
+	uint32	delay;			/* Candidate delay		*/
+	uint32	t;			/* Time at end of the delay	*/
+
+	if (tmcount == 0) {
+		return maxdelay;
+	}
+	for (delay = 1; delay < maxdelay; delay++) {
+		t = tmnow + delay;
+		if (((t & (TMSLOTS0 - 1)) == 0)
+		    || !tmempty(tmslot(t & (TMSLOTS0 - 1)))) {
+			return delay;
+		}
+	}
+	return maxdelay;
+}
@@ -0,0 +1,69 @@
+/* timer_add.c - timer_add, timer_cancel */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  timer_add  -  Arrange for a function to be called from the clock
+ *		    interrupt after a delay; a periodic callout can call
+ *		    timer_add again to rearm itself
+ *------------------------------------------------------------------------
+ */
+int32	timer_add(
+	  void		(*func)(void *),/* Function to call at expiry	*/
+	  void		*arg,		/* Argument passed to func	*/
+	  uint32	delay		/* Time to delay in msec.	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	int32	tid;			/* Callout entry to use		*/
+
+	if (func == NULL) {
+		return SYSERR;
+	}
+
+	mask = disable();
+	for (tid = NPROC; tid < NTIMER; tid++) {
+		if (tmtab[tid].tmfunc == NULL) {
+			break;
+		}
+	}
+	if (tid >= NTIMER) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	tmtab[tid].tmfunc = func;
+	tmtab[tid].tmarg = arg;
+	if (delay == 0) {
+		delay = 1;		/* Expire on the next tick	*/
+	}
+	tmenqueue(tid, tmnow + delay);
+
+	/* The clock may be idle past the new expiry, so restart it */
+
+	if (clkidle) {
+		clkresume();
+	}
+	restore(mask);
+	return tid;
+}
+
+/*------------------------------------------------------------------------
+ *  timer_cancel  -  Cancel a callout that has not yet run
+ *------------------------------------------------------------------------
+ */
+syscall	timer_cancel(
+	  int32		tid		/* ID returned by timer_add	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	mask = disable();
+	if (isbadtid(tid) || (tmdequeue(tid) == SYSERR)) {
+		restore(mask);
+		return SYSERR;
+	}
+	tmtab[tid].tmfunc = NULL;
+	restore(mask);
+	return OK;
+}
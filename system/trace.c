@@ -0,0 +1,58 @@
+/* trace.c - trevent, trstart, trstop */
+
+#include <xinu.h>
+
+struct	trrec	trtab[NTRACE];		/* The ring of records		*/
+uint32	trnext = 0;			/* Total records written	*/
+bool8	trenabled = FALSE;		/* TRUE while tracing		*/
+
+/*------------------------------------------------------------------------
+ *  trevent  -  Append an event to the trace ring, overwriting the
+ *		  oldest record once the ring is full
+ *------------------------------------------------------------------------
+ */
+void	trevent(
+	  uint16	event,		/* Event type (TR_xxx)		*/
+	  uint32	a,		/* First event argument		*/
+	  uint32	b		/* Second event argument	*/
+	)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+	struct	trrec	*trptr;		/* Record being written		*/
+
+	/* Only the slot reservation needs interrupts masked; no lock	*/
+	/*   is taken, so tracing works from interrupt handlers too	*/
+
+	mask = disable();
+	trptr = &trtab[trnext++ & (NTRACE - 1)];
+	restore(mask);
+
+	trptr->trcycles = getcycles();
+	trptr->trevent = event;
+	trptr->trpid = (uint16)currpid;
+	trptr->tra = a;
+	trptr->trb = b;
+}
+
+/*------------------------------------------------------------------------
+ *  trstart  -  Clear the trace ring and start recording events
+ *------------------------------------------------------------------------
+ */
+void	trstart(void)
+{
+	intmask	mask;			/* Saved interrupt mask		*/
+
+	mask = disable();
+	trnext = 0;
+	trenabled = TRUE;
+	restore(mask);
+}
+
+/*------------------------------------------------------------------------
+ *  trstop  -  Stop recording events, leaving the ring intact
+ *------------------------------------------------------------------------
+ */
+void	trstop(void)
+{
+	trenabled = FALSE;
+}
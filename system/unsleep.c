@@ -3,9 +3,8 @@
 #include <xinu.h>
 
 /*------------------------------------------------------------------------
- *  unsleep  -  Internal function to remove a process from the sleep
- *		    queue prematurely.  The caller must adjust the delay
- *		    of successive processes.
+ *  unsleep  -  Internal function to cancel the timer of a sleeping
+ *		    process prematurely
  *------------------------------------------------------------------------
  */
 status	unsleep(
@@ -15,10 +14,6 @@ status	unsleep(
 	intmask	mask;			/* Saved interrupt mask		*/
         struct	procent	*prptr;		/* Ptr to process' table entry	*/
 
-        pid32	pidnext;		/* ID of process on sleep queue	*/
-					/*   that follows the process	*/
-					/*   which is being removed	*/
-
 	mask = disable();
 
 	if (isbadpid(pid)) {
@@ -26,7 +21,7 @@ status	unsleep(
 		return SYSERR;
 	}
 
-	/* Verify that candidate process is on the sleep queue */
+	/* Verify that candidate process has a timer running */
 
 	prptr = &proctab[pid];
 	if ((prptr->prstate!=PR_SLEEP) && (prptr->prstate!=PR_RECTIM)) {
@@ -34,14 +29,7 @@ status	unsleep(
 		return SYSERR;
 	}
 
-	/* Increment delay of next process if such a process exists */
-
-	pidnext = queuetab[pid].qnext;
-	if (pidnext < NPROC) {
-		queuetab[pidnext].qkey += queuetab[pid].qkey;
-	}
-
-	getitem(pid);			/* Unlink process from queue */
+	tmdequeue(pid);			/* Unlink timer from the wheel	*/
 	restore(mask);
 	return OK;
 }
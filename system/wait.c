@@ -26,6 +26,7 @@ syscall	wait(
 		return SYSERR;
 	}
 
+	trace(TR_WAIT, sem, semptr->scount);
 	if (--(semptr->scount) < 0) {		/* If caller must block	*/
 		prptr = &proctab[currpid];
 		prptr->prstate = PR_WAIT;	/* Set state to waiting	*/
@@ -0,0 +1,58 @@
+/* waitn.c - waitn */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  waitn  -  Wait on a semaphore count times, claiming count units
+ *------------------------------------------------------------------------
+ */
+syscall	waitn(
+	  sid32		sem,		/* ID of semaphore to wait on	*/
+	  int32		count		/* Number of units to claim	*/
+	)
+{
+	intmask mask;			/* Saved interrupt mask		*/
+	struct	procent *prptr;		/* Ptr to process' table entry	*/
+	struct	sentry *semptr;		/* Ptr to sempahore table entry	*/
+
+	mask = disable();
+	if (isbadsem(sem) || (count < 0)) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	semptr = &semtab[sem];
+	if (semptr->sstate == S_FREE) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	trace(TR_WAIT, sem, semptr->scount);
+
+	/* Common case: every unit is available, so take them at once	*/
+
+	if (semptr->scount >= count) {
+		semptr->scount -= count;
+		restore(mask);
+		return OK;
+	}
+
+	/* Otherwise claim units one at a time, blocking as wait does	*/
+
+	prptr = &proctab[currpid];
+	for (; count > 0; count--) {
+		if (--(semptr->scount) < 0) {	/* If caller must block	*/
+			prptr->prstate = PR_WAIT;
+			prptr->prsem = sem;
+			enqueue(currpid,semptr->squeue);
+			resched();
+			if (semptr->sstate == S_FREE) {	/* Deleted	*/
+				restore(mask);
+				return SYSERR;
+			}
+		}
+	}
+
+	restore(mask);
+	return OK;
+}
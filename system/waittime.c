@@ -0,0 +1,61 @@
+/* waittime.c - waittime */
+
+#include <xinu.h>
+
+/*------------------------------------------------------------------------
+ *  waittime  -  Wait on a semaphore for at most a specified time
+ *------------------------------------------------------------------------
+ */
+syscall	waittime(
+	  sid32		sem,		/* Semaphore on which to wait	*/
+	  int32		maxwait		/* Ms to wait before timeout	*/
+	)
+{
+	intmask mask;			/* Saved interrupt mask		*/
+	struct	procent *prptr;		/* Ptr to process' table entry	*/
+	struct	sentry *semptr;		/* Ptr to sempahore table entry	*/
+
+	if (maxwait < 0) {
+		return SYSERR;
+	}
+	mask = disable();
+	if (isbadsem(sem)) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	semptr = &semtab[sem];
+	if (semptr->sstate == S_FREE) {
+		restore(mask);
+		return SYSERR;
+	}
+
+	trace(TR_WAIT, sem, semptr->scount);
+	if (semptr->scount <= 0) {		/* If caller must block	*/
+		if (maxwait == 0) {
+			restore(mask);
+			return TIMEOUT;
+		}
+		semptr->scount--;
+		prptr = &proctab[currpid];
+		prptr->prstate = PR_WAIT;	/* Set state to waiting	*/
+		prptr->prsem = sem;		/* Record semaphore ID	*/
+		prptr->prtimeout = FALSE;
+		enqueue(currpid,semptr->squeue);/* Enqueue on semaphore	*/
+		tmenqueue(currpid, tmnow + maxwait);
+		resched();			/*   and reschedule	*/
+
+		/* The timer removes the process from the semaphore	*/
+		/*   queue and restores the count if it expires first	*/
+
+		if (prptr->prtimeout) {
+			restore(mask);
+			return TIMEOUT;
+		}
+	} else {
+		semptr->scount--;
+	}
+
+	restore(mask);
+	return OK;
+}
@@ -2,19 +2,92 @@
 
 #include <xinu.h>
 
+local	void	wakeproc(pid32);
+
 /*------------------------------------------------------------------------
- *  wakeup  -  Called by clock interrupt handler to awaken processes
+ *  wakeup  -  Called by clock interrupt handler once per millisecond to
+ *		 advance the timing wheel, awaken processes whose delay
+ *		 has expired, and run callouts that are due
  *------------------------------------------------------------------------
  */
 void	wakeup(void)
 {
-	/* Awaken all processes that have no more time to sleep */
+	int32	head;			/* Head of the slot that expires*/
+	int32	tid;			/* Timer that has expired	*/
+	int32	level;			/* Level being cascaded		*/
+	int32	shift;			/* Bits below the level's index	*/
+	int32	index;			/* Slot within a level		*/
+	void	(*func)(void *);	/* Callout to run		*/
 
-	resched_cntl(DEFER_START);
-	while (nonempty(sleepq) && (firstkey(sleepq) <= 0)) {
-		ready(dequeue(sleepq));
+	tmnow++;
+	if (tmcount == 0) {
+		return;
+	}
+
+	/* When level 0 wraps, bring down the timers of the next slot	*/
+	/*   of level 1, and so on up the wheel				*/
+
+	if ((tmnow & (TMSLOTS0 - 1)) == 0) {
+		shift = TMBITS0;
+		for (level = 1; level < NTMLEVEL; level++) {
+			index = (tmnow >> shift) & (TMSLOTSN - 1);
+			tmcascade(level, index);
+			if (index != 0) {
+				break;
+			}
+			shift += TMBITSN;
+		}
 	}
 
+	/* Awaken all processes that have no more time to sleep and	*/
+	/*   run the callouts that are due				*/
+
+	head = tmslot(tmnow & (TMSLOTS0 - 1));
+	resched_cntl(DEFER_START);
+	while (!tmempty(head)) {
+		tid = tmtab[head].tmnext;
+		tmdequeue(tid);
+		if (tid < NPROC) {
+			wakeproc(tid);
+		} else {
+			func = tmtab[tid].tmfunc;
+			tmtab[tid].tmfunc = NULL;
+			func(tmtab[tid].tmarg);
+		}
+	}
 	resched_cntl(DEFER_STOP);
 	return;
 }
+
+/*------------------------------------------------------------------------
+ *  wakeproc  -  Make a process whose timer expired ready, first taking
+ *		   it off the queue of a timed wait that has run out
+ *------------------------------------------------------------------------
+ */
+local	void	wakeproc(		/* Assumes interrupts disabled	*/
+	  pid32		pid		/* ID of process to awaken	*/
+	)
+{
+	struct	procent	*prptr;		/* Ptr to process' table entry	*/
+
+	prptr = &proctab[pid];
+	switch (prptr->prstate) {
+
+	case PR_WAIT:			/* waittime ran out		*/
+		semtab[prptr->prsem].scount++;
+		getitem(pid);
+		prptr->prtimeout = TRUE;
+		break;
+
+	case PR_FWAIT:			/* future_get_timeout ran out	*/
+		if (prptr->prwaitq != EMPTY) {
+			getitem(pid);
+		}
+		prptr->prtimeout = TRUE;
+		break;
+
+	default:
+		break;
+	}
+	ready(pid);
+}